@@ -220,7 +220,8 @@ public:
         Enum,
         List,
         Map,
-        Variant
+        Variant,
+        Lazy
     };
 
 public:
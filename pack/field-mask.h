@@ -0,0 +1,101 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+namespace pack {
+
+class INode;
+
+// =========================================================================================================================================
+
+/// Field mask (projection)
+///
+/// Set of the dotted paths of the field keys, for example {"status", "metrics.load"}. Selected field is taken with
+/// the whole subtree, lists and maps are transparent: mask of the list applies to every element of it.
+/// Empty mask selects everything.
+/// For every node type mask is compiled once into a bitset of the selected fields, so walking is cheap. Compiled
+/// selections are looked up by every thread in its own cache, without locking.
+class FieldMask
+{
+public:
+    /// Compiled mask for a node type
+    struct Selection
+    {
+        /// Selected fields, indexes are the same as in INode::fields()
+        std::vector<bool> fields;
+        /// Mask of the selected field, nullptr if whole field is selected
+        std::vector<const FieldMask*> children;
+    };
+
+    /// Activates mask for the current thread while in scope, used by serializers
+    class Scope
+    {
+    public:
+        Scope(const FieldMask* mask);
+        ~Scope();
+
+    private:
+        const FieldMask* m_prev;
+    };
+
+public:
+    FieldMask() = default;
+    FieldMask(std::initializer_list<std::string> paths);
+    FieldMask(const std::vector<std::string>& paths);
+    FieldMask(const FieldMask& other);
+    FieldMask& operator=(const FieldMask& other);
+
+    /// Adds dotted path to the mask
+    void add(const std::string& path);
+
+    /// Checks if mask selects everything
+    bool empty() const;
+
+    /// Returns mask of the field by its key, nullptr if the field is not selected (empty mask if it is selected whole)
+    const FieldMask* find(const std::string& key) const;
+
+    /// Returns selection for the node, compiled on the first call for the node type
+    const Selection& select(const INode& node) const;
+
+    /// Returns active mask of the current thread or nullptr if there is no one
+    static const FieldMask* active();
+
+private:
+    /// Returns new unique version of the mask content, thread caches of the older ones are not used anymore
+    static uint64_t nextVersion();
+
+    /// Compiles selection for the node type, shared by the threads
+    const Selection& compile(const INode& node) const;
+
+private:
+    uint64_t                         m_version = nextVersion();
+    bool                             m_whole   = false;
+    std::map<std::string, FieldMask> m_children;
+    mutable std::mutex               m_mutex;
+    mutable std::map<std::type_index, Selection> m_compiled;
+};
+
+// =========================================================================================================================================
+
+} // namespace pack
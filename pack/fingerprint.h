@@ -0,0 +1,60 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace pack {
+
+class Attribute;
+class Node;
+
+// =========================================================================================================================================
+
+/// Returns 64-bit fingerprint of the node content (xxHash64 of the field keys and values)
+///
+/// Fields are fed in the declaration order, containers in their own order, nothing is serialized. Fields without
+/// value are skipped as they are by serializers, so equal nodes have equal fingerprints. Not cryptographic and not
+/// stable between library versions: use it for caches and change detection, not for persisting.
+uint64_t fingerprint(const Attribute& node);
+
+/// Hasher for unordered containers of nodes, e.g. std::unordered_set<MyNode, pack::Hash>
+struct Hash
+{
+    size_t operator()(const Attribute& node) const
+    {
+        return size_t(fingerprint(node));
+    }
+};
+
+// =========================================================================================================================================
+
+} // namespace pack
+
+namespace std {
+
+template <>
+struct hash<pack::Attribute> : pack::Hash
+{
+};
+
+template <>
+struct hash<pack::Node> : pack::Hash
+{
+};
+
+} // namespace std
@@ -0,0 +1,260 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#pragma once
+#include "pack/node.h"
+
+namespace pack {
+
+// =========================================================================================================================================
+
+/// Lazy node interface
+///
+/// Keeps raw serialized content of the subtree until first access to the node.
+class ILazy : public Attribute
+{
+public:
+    /// Format of the raw content
+    enum class Format
+    {
+        None,
+        Json,
+        Yaml,
+        Protobuf
+    };
+
+public:
+    ILazy(Attribute* parent, const std::string& key = {});
+
+    /// Checks if content is not decoded yet
+    bool isRaw() const;
+
+    /// Returns format of the raw content
+    Format format() const;
+
+    /// Returns raw content
+    const std::string& raw() const;
+
+    /// Sets raw content, it will be decoded on first access
+    void setRaw(Format format, std::string&& content);
+
+    /// Returns node, decodes raw content if any
+    const INode& node() const;
+
+    /// Returns node, decodes raw content if any
+    INode& node();
+
+protected:
+    /// Returns node as is, without decoding
+    virtual const INode& holder() const = 0;
+
+    /// Returns node as is, without decoding
+    virtual INode& holder() = 0;
+
+    /// Decodes raw content into the holder, throws on error
+    void decode() const;
+
+protected:
+    mutable Format      m_format = Format::None;
+    mutable std::string m_raw;
+};
+
+// =========================================================================================================================================
+
+/// Lazy node
+///
+/// Node which is decoded only when accessed. Useful for rarely read parts of the message, if the node is not touched
+/// it will be serialized back from the raw content.
+/// Typical usage is:
+/// ---------------------------
+/// struct Message: public pack::Node {
+///     pack::String            id      = FIELD("id");
+///     pack::Lazy<Payload>     payload = FIELD("payload");
+///     ...
+/// }
+/// ---------------------------
+/// Decoding is done in place and is not thread safe.
+template <typename T>
+class Lazy : public ILazy
+{
+public:
+    using ILazy::ILazy;
+
+    Lazy();
+    Lazy(const Lazy& other);
+    Lazy(Lazy&& other);
+    Lazy& operator=(const Lazy& other);
+    Lazy& operator=(Lazy&& other);
+
+public:
+    const T& value() const;
+    T&       value();
+    const T* operator->() const;
+    T*       operator->();
+
+    static std::string typeInfo();
+
+public:
+    bool        compare(const Attribute& other) const override;
+    std::string typeName() const override;
+    void        set(const Attribute& other) override;
+    void        set(Attribute&& other) override;
+    bool        hasValue() const override;
+    void        clear() override;
+
+protected:
+    const INode& holder() const override;
+    INode&       holder() override;
+
+private:
+    T m_value;
+};
+
+// =========================================================================================================================================
+
+template <typename T>
+Lazy<T>::Lazy()
+    : ILazy(nullptr)
+{
+}
+
+template <typename T>
+Lazy<T>::Lazy(const Lazy& other)
+    : ILazy(other)
+    , m_value(other.m_value)
+{
+}
+
+template <typename T>
+Lazy<T>::Lazy(Lazy&& other)
+    : ILazy(std::move(other))
+    , m_value(std::move(other.m_value))
+{
+}
+
+template <typename T>
+Lazy<T>& Lazy<T>::operator=(const Lazy& other)
+{
+    set(other);
+    return *this;
+}
+
+template <typename T>
+Lazy<T>& Lazy<T>::operator=(Lazy&& other)
+{
+    set(std::move(other));
+    return *this;
+}
+
+template <typename T>
+const T& Lazy<T>::value() const
+{
+    decode();
+    return m_value;
+}
+
+template <typename T>
+T& Lazy<T>::value()
+{
+    decode();
+    return m_value;
+}
+
+template <typename T>
+const T* Lazy<T>::operator->() const
+{
+    return &value();
+}
+
+template <typename T>
+T* Lazy<T>::operator->()
+{
+    return &value();
+}
+
+template <typename T>
+std::string Lazy<T>::typeInfo()
+{
+    return "Lazy<" + T::typeInfo() + ">";
+}
+
+template <typename T>
+bool Lazy<T>::compare(const Attribute& other) const
+{
+    if (auto casted = dynamic_cast<const Lazy<T>*>(&other)) {
+        if (isRaw() && casted->isRaw() && format() == casted->format() && raw() == casted->raw()) {
+            return true;
+        }
+        return value().compare(casted->value());
+    }
+    return false;
+}
+
+template <typename T>
+std::string Lazy<T>::typeName() const
+{
+    return typeInfo();
+}
+
+template <typename T>
+void Lazy<T>::set(const Attribute& other)
+{
+    if (auto casted = dynamic_cast<const Lazy<T>*>(&other)) {
+        m_format = casted->m_format;
+        m_raw    = casted->m_raw;
+        m_value  = casted->m_value;
+    }
+}
+
+template <typename T>
+void Lazy<T>::set(Attribute&& other)
+{
+    if (auto casted = dynamic_cast<Lazy<T>*>(&other)) {
+        m_format = casted->m_format;
+        m_raw    = std::move(casted->m_raw);
+        m_value  = std::move(casted->m_value);
+    }
+}
+
+template <typename T>
+bool Lazy<T>::hasValue() const
+{
+    return isRaw() || m_value.hasValue();
+}
+
+template <typename T>
+void Lazy<T>::clear()
+{
+    m_format = Format::None;
+    m_raw.clear();
+    m_value.clear();
+}
+
+template <typename T>
+const INode& Lazy<T>::holder() const
+{
+    return m_value;
+}
+
+template <typename T>
+INode& Lazy<T>::holder()
+{
+    return m_value;
+}
+
+// =========================================================================================================================================
+
+} // namespace pack
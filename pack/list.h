@@ -55,6 +55,17 @@ public:
     /// Returns INode interface by index
     virtual const Attribute& get(int index) const = 0;
     virtual Attribute&       create()             = 0;
+
+    /// Returns INode interface by index, for filling. Default one goes through the const one, lists override it.
+    virtual Attribute& get(int index)
+    {
+        return const_cast<Attribute&>(static_cast<const IObjectList&>(*this).get(index));
+    }
+
+    /// Reserves memory for `size` elements, so they could be created without reallocations. Does nothing by default.
+    virtual void reserve(int /*size*/)
+    {
+    }
 };
 
 // =========================================================================================================================================
@@ -127,7 +138,9 @@ public:
     void             set(Attribute&& other) override;
     bool             hasValue() const override;
     const Attribute& get(int index) const override;
+    Attribute&       get(int index) override;
     Attribute&       create() override;
+    void             reserve(int size) override;
     void             clear() override;
 
 private:
@@ -163,8 +176,13 @@ public:
 public:
     const ListType& value() const;
     void            setValue(const ListType& val);
+    void            setValue(ListType&& val);
     void            append(const CppType& value);
     void            append(CppType&& value);
+    /// Reserves memory for `size` values
+    void            reserve(int size);
+    /// Appends `count` default values, returns the first of them to fill in place
+    CppType*        extend(int count);
 
     bool           find(const CppType& func) const;
     bool           remove(const CppType& toRemove);
@@ -380,12 +398,24 @@ const Attribute& ObjectList<T>::get(int index) const
     return m_value[size_t(index)];
 }
 
+template <typename T>
+Attribute& ObjectList<T>::get(int index)
+{
+    return m_value[size_t(index)];
+}
+
 template <typename T>
 Attribute& ObjectList<T>::create()
 {
     return append();
 }
 
+template <typename T>
+void ObjectList<T>::reserve(int size)
+{
+    m_value.reserve(size_t(size));
+}
+
 template <typename T>
 bool ObjectList<T>::empty() const
 {
@@ -465,6 +495,26 @@ void ValueList<ValType>::setValue(const ValueList<ValType>::ListType& val)
     m_value = val;
 }
 
+template <Type ValType>
+void ValueList<ValType>::setValue(ValueList<ValType>::ListType&& val)
+{
+    m_value = std::move(val);
+}
+
+template <Type ValType>
+void ValueList<ValType>::reserve(int size)
+{
+    m_value.reserve(size_t(size));
+}
+
+template <Type ValType>
+typename ValueList<ValType>::CppType* ValueList<ValType>::extend(int count)
+{
+    size_t size = m_value.size();
+    m_value.resize(size + size_t(count));
+    return m_value.data() + size;
+}
+
 template <Type ValType>
 void ValueList<ValType>::append(const CppType& value)
 {
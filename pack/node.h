@@ -16,6 +16,7 @@
 
 #pragma once
 #include "pack/attribute.h"
+#include <string_view>
 
 namespace pack {
 
@@ -44,6 +45,16 @@ public:
     virtual const std::string& fileDescriptor() const = 0;
 
     virtual std::string protoName() const = 0;
+
+    /// Writes the node as protobuf message content by the codec generated with protoc plugin, returns false if there
+    /// is no one (protobuf provider does it by message descriptor then)
+    virtual bool encodeProto(std::string& out) const;
+
+    /// Reads the node from protobuf message content by the generated codec, returns false if there is no one
+    virtual bool decodeProto(std::string_view content);
+
+    /// Returns size of protobuf message content by the generated codec, returns false if there is no one
+    virtual bool protoSize(size_t& size) const;
 };
 
 // =========================================================================================================================================
@@ -93,4 +104,16 @@ public:
 
 // =========================================================================================================================================
 
+/// Embedded file descriptor set of the generated proto file
+using FileDescriptorFunc = const std::string& (*)();
+
+/// Registers file descriptor of the generated proto file (done by generated code on start), protobuf provider could
+/// preload all of them
+bool registerFileDescriptor(FileDescriptorFunc descriptor);
+
+/// Returns all registered file descriptors
+std::vector<FileDescriptorFunc> registeredFileDescriptors();
+
+// =========================================================================================================================================
+
 } // namespace pack
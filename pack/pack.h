@@ -17,6 +17,8 @@
 #pragma once
 #include "fty/convert.h"
 #include "pack/enum.h"
+#include "pack/fingerprint.h"
+#include "pack/lazy.h"
 #include "pack/list.h"
 #include "pack/map.h"
 #include "pack/node.h"
@@ -18,6 +18,7 @@
 #include "pack/node.h"
 #include <algorithm>
 #include <stdexcept>
+#include <utility>
 
 namespace pack {
 
@@ -34,6 +35,34 @@ public:
     virtual Node&       create()             = 0;
     virtual const Node& get(int index) const = 0;
     virtual int         size() const         = 0;
+
+    /// Returns key of the entry by index. Default one looks for the "key" field of the entry node.
+    virtual const Attribute& entryKey(int index) const
+    {
+        return entryField(get(index), "key");
+    }
+
+    /// Returns value of the entry by index. Default one looks for the "value" field of the entry node.
+    virtual const Attribute& entryValue(int index) const
+    {
+        return entryField(get(index), "value");
+    }
+
+    /// Adds new entry, returns its key and value to fill
+    virtual std::pair<Attribute&, Attribute&> createEntry()
+    {
+        const Node& entry = create();
+        return {const_cast<Attribute&>(entryField(entry, "key")), const_cast<Attribute&>(entryField(entry, "value"))};
+    }
+
+private:
+    static const Attribute& entryField(const Node& entry, const std::string& key)
+    {
+        if (const Attribute* field = entry.fieldByKey(key)) {
+            return *field;
+        }
+        throw std::runtime_error("Map entry has no field " + key);
+    }
 };
 
 // =========================================================================================================================================
@@ -74,6 +103,10 @@ public:
     int         size() const override;
     const Node& get(int index) const override;
 
+    const Attribute&                  entryKey(int index) const override;
+    const Attribute&                  entryValue(int index) const override;
+    std::pair<Attribute&, Attribute&> createEntry() override;
+
 private:
     MapType m_value;
 };
@@ -209,6 +242,25 @@ const Node& ProtoMap<KeyValue>::get(int index) const
     return m_value[size_t(index)];
 }
 
+template <typename KeyValue>
+const Attribute& ProtoMap<KeyValue>::entryKey(int index) const
+{
+    return m_value[size_t(index)].key;
+}
+
+template <typename KeyValue>
+const Attribute& ProtoMap<KeyValue>::entryValue(int index) const
+{
+    return m_value[size_t(index)].value;
+}
+
+template <typename KeyValue>
+std::pair<Attribute&, Attribute&> ProtoMap<KeyValue>::createEntry()
+{
+    KeyValue& it = m_value.emplace_back();
+    return {it.key, it.value};
+}
+
 // =========================================================================================================================================
 
 } // namespace pack
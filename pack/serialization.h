@@ -16,36 +16,127 @@
 
 #pragma once
 
+#include "pack/field-mask.h"
 #include "pack/node.h"
 #include <fty/expected.h>
 #include <fty/flags.h>
+#include <functional>
+#include <iosfwd>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#ifdef WITH_PROTOBUF
+namespace google::protobuf::io {
+class ZeroCopyOutputStream;
+}
+#endif
 
 namespace pack {
 
 enum class Option
 {
-    No            = 1 << 0,
-    WithDefaults  = 1 << 1,
-    ValueAsString = 1 << 2,
-    PrettyPrint   = 1 << 3
+    No             = 1 << 0,
+    WithDefaults   = 1 << 1,
+    ValueAsString  = 1 << 2,
+    PrettyPrint    = 1 << 3,
+    BinaryAsBase64 = 1 << 4,
+    Canonical      = 1 << 5
 };
 
 ENABLE_FLAGS(Option)
 
 
 class INode;
+class IObjectList;
+
+/// Result of the batch serialization: encodings of all the elements back-to-back in one buffer
+struct Batch
+{
+    /// Position of the element encoding in the buffer
+    struct Slice
+    {
+        size_t offset = 0;
+        size_t size   = 0;
+    };
+
+    std::string        buffer;
+    std::vector<Slice> slices;
+
+    /// Returns encoding of the element
+    std::string_view operator[](size_t index) const
+    {
+        return std::string_view(buffer).substr(slices[index].offset, slices[index].size);
+    }
+
+    /// Returns count of the elements
+    size_t size() const
+    {
+        return slices.size();
+    }
+
+    /// Clears content, but keeps allocated memory, so batch could be reused
+    void clear()
+    {
+        buffer.clear();
+        slices.clear();
+    }
+};
 
 namespace json {
     fty::Expected<std::string> serialize(const Attribute& node, Option opt = Option::No);
+    /// Serializes only the fields selected by the mask
+    fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt = Option::No);
+    /// Appends serialized content to `out`, so caller could reuse the buffer
+    fty::Expected<void>        serialize(const Attribute& node, std::string& out, Option opt = Option::No);
+    /// Writes serialized content directly to the stream
+    fty::Expected<void>        serialize(const Attribute& node, std::ostream& out, Option opt = Option::No);
+    /// Returns exact length of the serialized content, computed from the node without producing the content
+    fty::Expected<size_t>      serializedSize(const Attribute& node, Option opt = Option::No);
+    /// Appends encodings of all the nodes to the batch, one json document per node
+    fty::Expected<void>        serialize(const std::vector<const Attribute*>& nodes, Batch& out, Option opt = Option::No);
+    fty::Expected<void>        serialize(const IObjectList& list, Batch& out, Option opt = Option::No);
     fty::Expected<void>        deserialize(const std::string& content, Attribute& node);
+    /// Deserializes payloads[i] into nodes[i] concurrently by `threads` workers (0 means hardware concurrency), payloads
+    /// are only read, so they could point into the caller's buffers
+    fty::Expected<void>        deserializeMany(
+        const std::vector<std::string_view>& payloads, const std::vector<Attribute*>& nodes, size_t threads = 0);
+    /// Deserializes only the fields selected by the mask, json parser skips the rest without building it
+    fty::Expected<void>        deserialize(const std::string& content, Attribute& node, const FieldMask& mask);
     fty::Expected<void>        deserializeFile(const std::string& fileName, Attribute& node);
     fty::Expected<void>        serializeFile(const std::string& fileName, const Attribute& node, Option opt = Option::No);
+
+    /// Writes list as JSON lines (NDJSON): one compact json document per element, element by element
+    fty::Expected<void> serializeLines(std::ostream& out, const IObjectList& list, Option opt = Option::No);
+
+    /// Reads JSON lines (NDJSON), every line is deserialized into the same `item` and `func` is called after
+    fty::Expected<void> deserializeLines(std::istream& in, Attribute& item, const std::function<void()>& func);
+
+    /// Reads JSON lines (NDJSON) into `batch`, `func` is called when `batchSize` elements were collected (and for
+    /// the rest at the end of the stream), batch is cleared after each call
+    fty::Expected<void> deserializeLines(
+        std::istream& in, IObjectList& batch, int batchSize, const std::function<void(IObjectList&)>& func);
+
+    /// Reads JSON lines (NDJSON) element by element into a single T and calls `func` for every one
+    template <typename T, typename Func>
+    fty::Expected<void> deserializeLines(std::istream& in, Func&& func)
+    {
+        T item;
+        return deserializeLines(in, item, [&]() {
+            func(item);
+        });
+    }
 } // namespace json
 
 namespace yaml {
     fty::Expected<std::string> serialize(const Attribute& node, Option opt = Option::No);
+    fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt = Option::No);
+    fty::Expected<void>        serialize(const Attribute& node, std::string& out, Option opt = Option::No);
+    fty::Expected<void>        serialize(const Attribute& node, std::ostream& out, Option opt = Option::No);
     fty::Expected<void>        deserialize(const std::string& content, Attribute& node);
+    fty::Expected<void>        deserialize(const std::string& content, Attribute& node, const FieldMask& mask);
     fty::Expected<void>        deserializeFile(const std::string& fileName, Attribute& node);
     fty::Expected<void>        serializeFile(const std::string& fileName, const Attribute& node, Option opt = Option::No);
 } // namespace yaml
@@ -53,7 +144,11 @@ namespace yaml {
 #ifdef WITH_ZCONFIG
 namespace zconfig {
     fty::Expected<std::string> serialize(const Attribute& node, Option opt = Option::No);
+    fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt = Option::No);
+    fty::Expected<void>        serialize(const Attribute& node, std::string& out, Option opt = Option::No);
+    fty::Expected<void>        serialize(const Attribute& node, std::ostream& out, Option opt = Option::No);
     fty::Expected<void>        deserialize(const std::string& content, Attribute& node);
+    fty::Expected<void>        deserialize(const std::string& content, Attribute& node, const FieldMask& mask);
     fty::Expected<void>        deserializeFile(const std::string& fileName, Attribute& node);
 } // namespace zconfig
 #endif
@@ -61,8 +156,91 @@ namespace zconfig {
 #ifdef WITH_PROTOBUF
 namespace protobuf {
     fty::Expected<std::string> serialize(const Attribute& node, Option opt = Option::No);
-    fty::Expected<void>        deserialize(const std::string& content, Attribute& node);
+    fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt = Option::No);
+    fty::Expected<void>        serialize(const Attribute& node, std::string& out, Option opt = Option::No);
+    fty::Expected<void>        serialize(const Attribute& node, std::ostream& out, Option opt = Option::No);
+    /// Writes encoded message into the buffers of the protobuf output stream
+    fty::Expected<void>        serialize(
+        const Attribute& node, google::protobuf::io::ZeroCopyOutputStream& out, Option opt = Option::No);
+    /// Writes encoded message directly to the file descriptor (file, pipe or socket)
+    fty::Expected<void>        serializeToFd(const Attribute& node, int fd, Option opt = Option::No);
+    fty::Expected<void>        serializeFile(const std::string& fileName, const Attribute& node, Option opt = Option::No);
+    /// Returns exact length of the encoded message
+    fty::Expected<size_t>      serializedSize(const Attribute& node, Option opt = Option::No);
+    /// Appends encodings of all the nodes to the batch
+    fty::Expected<void>        serialize(const std::vector<const Attribute*>& nodes, Batch& out, Option opt = Option::No);
+    fty::Expected<void>        serialize(const IObjectList& list, Batch& out, Option opt = Option::No);
+    /// Content is only read while deserializing, caller's buffer could be passed without copying it into a string
+    fty::Expected<void>        deserialize(std::string_view content, Attribute& node);
+    /// Deserializes payloads[i] into nodes[i] concurrently by `threads` workers (0 means hardware concurrency), payloads
+    /// are only read, so they could point into the caller's buffers
+    fty::Expected<void>        deserializeMany(
+        const std::vector<std::string_view>& payloads, const std::vector<Attribute*>& nodes, size_t threads = 0);
+    fty::Expected<void>        deserialize(std::string_view content, Attribute& node, const FieldMask& mask);
+    /// File is mapped into memory and decoded from there
     fty::Expected<void>        deserializeFile(const std::string& fileName, Attribute& node);
+
+    /// Writes message prefixed by its varint length (as `writeDelimitedTo` of protobuf), so many messages could be
+    /// written one after another into the same stream or file
+    fty::Expected<void> serializeDelimited(std::ostream& out, const Attribute& node, Option opt = Option::No);
+
+    /// Writes every element of the list as length delimited message
+    fty::Expected<void> serializeDelimited(std::ostream& out, const IObjectList& list, Option opt = Option::No);
+
+    /// Reads length delimited messages one by one into the same `item` and calls `func` after every one, only one
+    /// message is kept in memory
+    fty::Expected<void> deserializeDelimited(std::istream& in, Attribute& item, const std::function<void()>& func);
+
+    /// Reads length delimited messages of the buffer into the same `item` and calls `func` after every one
+    fty::Expected<void> deserializeDelimited(std::string_view content, Attribute& item, const std::function<void()>& func);
+
+    /// Reads length delimited messages one by one into a single T and calls `func` for every one
+    template <typename T, typename Func>
+    fty::Expected<void> deserializeDelimited(std::istream& in, Func&& func)
+    {
+        T item;
+        return deserializeDelimited(in, item, [&]() {
+            func(item);
+        });
+    }
+
+    /// Builds message descriptors of the nodes up front by `threads` workers (0 means hardware concurrency), so the
+    /// first messages of these types don't pay for parsing of the embedded file descriptors
+    fty::Expected<void> preload(const std::vector<const INode*>& nodes, size_t threads = 0);
+
+    /// Builds message descriptors of the node types up front
+    template <typename... T>
+    fty::Expected<void> preload(size_t threads = 0)
+    {
+        std::tuple<T...> nodes;
+        return std::apply(
+            [&](const auto&... it) {
+                return preload({&it...}, threads);
+            },
+            nodes);
+    }
+
+    /// Builds descriptors of all the proto files generated by protoc plugin and linked into the program
+    fty::Expected<void> preloadAll(size_t threads = 0);
+
+    /// Reusable state for many calls with the same few node types: encoding buffer and resolved message descriptors
+    /// are kept between the calls. Not thread safe, every thread should have its own context.
+    class Context
+    {
+    public:
+        Context();
+        ~Context();
+        Context(const Context&) = delete;
+        Context& operator=(const Context&) = delete;
+
+        /// Serializes node into the context buffer, returned content is valid till the next call
+        fty::Expected<std::string_view> serialize(const Attribute& node, Option opt = Option::No);
+        fty::Expected<void>             deserialize(std::string_view content, Attribute& node);
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> m_impl;
+    };
 } // namespace protobuf
 #endif
 
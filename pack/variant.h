@@ -35,6 +35,19 @@ public:
     virtual const Attribute* get() const                                        = 0;
     virtual Attribute*       get()                                              = 0;
     virtual bool             findBetter(const std::vector<std::string>& fields) = 0;
+
+    /// Returns position of the active alternative in the list of types, std::variant_npos if it is not known (default)
+    virtual size_t index() const
+    {
+        return std::variant_npos;
+    }
+
+    /// Makes alternative at the position active (default value), returns it. Default one does not know the types and
+    /// returns nullptr, the alternative is skipped then.
+    virtual Attribute* resetAt(size_t /*index*/)
+    {
+        return nullptr;
+    }
 };
 
 // =========================================================================================================================================
@@ -75,6 +88,8 @@ public:
     const Attribute*   get() const override;
     Attribute*         get() override;
     bool               findBetter(const std::vector<std::string>& fields) override;
+    size_t             index() const override;
+    Attribute*         resetAt(size_t index) override;
     static std::string typeInfo();
 
 public:
@@ -293,6 +308,28 @@ bool Variant<Types...>::findBetter(const std::vector<std::string>& fields)
     }
 }
 
+template <typename... Types>
+size_t Variant<Types...>::index() const
+{
+    return m_value.index();
+}
+
+template <typename... Types>
+Attribute* Variant<Types...>::resetAt(size_t index)
+{
+    using Reset = void (*)(std::variant<Types...>&);
+
+    static const Reset resets[] = {[](std::variant<Types...>& val) {
+        val.template emplace<Types>();
+    }...};
+
+    if (index >= sizeof...(Types)) {
+        throw std::out_of_range("Variant has no alternative " + std::to_string(index));
+    }
+    resets[index](m_value);
+    return get();
+}
+
 // =========================================================================================================================================
 
 } // namespace pack
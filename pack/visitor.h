@@ -40,6 +40,8 @@ public:
     template <typename Resource>
     static void visit(IProtoMap& map, const Resource& res)
     {
+        // Map entries are always unpacked whole
+        FieldMask::Scope whole(nullptr);
         Worker::unpackValue(map, res);
     }
 
@@ -190,6 +192,9 @@ public:
             case Attribute::NodeType::Variant:
                 visit(static_cast<IVariant&>(node), res);
                 break;
+            case Attribute::NodeType::Lazy:
+                visit(static_cast<ILazy&>(node), res);
+                break;
         }
     }
 
@@ -199,6 +204,42 @@ public:
         Worker::unpackValue(var, res);
     }
 
+    template <typename Resource>
+    static void visit(ILazy& lazy, const Resource& res)
+    {
+        Worker::unpackValue(lazy, res);
+    }
+
+    /// Calls `func` for every field of the node selected by active field mask, for all of them if there is no mask
+    template <typename Func>
+    static void eachField(INode& node, Func&& func)
+    {
+        eachFieldAt(node, [&](size_t /*index*/, Attribute& it) {
+            func(it);
+        });
+    }
+
+    /// The same as eachField, `func` gets also index of the field in INode::fields()
+    template <typename Func>
+    static void eachFieldAt(INode& node, Func&& func)
+    {
+        const FieldMask* mask = FieldMask::active();
+        const auto       flds = node.fields();
+        if (!mask || mask->empty()) {
+            for (size_t i = 0; i < flds.size(); ++i) {
+                func(i, *flds[i]);
+            }
+            return;
+        }
+
+        const auto& sel = mask->select(node);
+        for (size_t i = 0; i < flds.size(); ++i) {
+            if (sel.fields[i]) {
+                FieldMask::Scope scope(sel.children[i]);
+                func(i, *flds[i]);
+            }
+        }
+    }
 };
 
 // =========================================================================================================================================
@@ -222,6 +263,8 @@ public:
     template <typename Resource>
     static void visit(const IProtoMap& map, Resource& res, Option opt)
     {
+        // Map entries are always packed whole
+        FieldMask::Scope whole(nullptr);
         Worker::packValue(map, res, opt);
     }
 
@@ -372,6 +415,9 @@ public:
         case Attribute::NodeType::Variant:
             visit(static_cast<const IVariant&>(node), res, opt);
             break;
+        case Attribute::NodeType::Lazy:
+            visit(static_cast<const ILazy&>(node), res, opt);
+            break;
         }
     }
 
@@ -380,6 +426,43 @@ public:
     {
         Worker::packValue(var, res, opt);
     }
+
+    template <typename Resource>
+    static void visit(const ILazy& lazy, Resource& res, Option opt)
+    {
+        Worker::packValue(lazy, res, opt);
+    }
+
+    /// Calls `func` for every field of the node selected by active field mask, for all of them if there is no mask
+    template <typename Func>
+    static void eachField(const INode& node, Func&& func)
+    {
+        eachFieldAt(node, [&](size_t /*index*/, const Attribute& it) {
+            func(it);
+        });
+    }
+
+    /// The same as eachField, `func` gets also index of the field in INode::fields()
+    template <typename Func>
+    static void eachFieldAt(const INode& node, Func&& func)
+    {
+        const FieldMask* mask = FieldMask::active();
+        const auto       flds = node.fields();
+        if (!mask || mask->empty()) {
+            for (size_t i = 0; i < flds.size(); ++i) {
+                func(i, *flds[i]);
+            }
+            return;
+        }
+
+        const auto& sel = mask->select(node);
+        for (size_t i = 0; i < flds.size(); ++i) {
+            if (sel.fields[i]) {
+                FieldMask::Scope scope(sel.children[i]);
+                func(i, *flds[i]);
+            }
+        }
+    }
 };
 
 // =========================================================================================================================================
@@ -0,0 +1,535 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace pack::wire {
+
+// =========================================================================================================================================
+
+// Protobuf wire format primitives, used by protobuf provider and by the codecs generated by protoc plugin
+
+/// Wire types of the fields
+enum class WireType : uint32_t
+{
+    Varint  = 0,
+    Fixed64 = 1,
+    Bytes   = 2,
+    Fixed32 = 5
+};
+
+/// Field types, values are the same as google::protobuf::FieldDescriptor::Type
+enum class ProtoType
+{
+    Double   = 1,
+    Float    = 2,
+    Int64    = 3,
+    UInt64   = 4,
+    Int32    = 5,
+    Fixed64  = 6,
+    Fixed32  = 7,
+    Bool     = 8,
+    String   = 9,
+    Message  = 11,
+    Bytes    = 12,
+    UInt32   = 13,
+    Enum     = 14,
+    SFixed32 = 15,
+    SFixed64 = 16,
+    SInt32   = 17,
+    SInt64   = 18
+};
+
+/// Returns wire type of the single value of the field type
+constexpr WireType wireTypeOf(ProtoType type)
+{
+    switch (type) {
+        case ProtoType::Double:
+        case ProtoType::Fixed64:
+        case ProtoType::SFixed64:
+            return WireType::Fixed64;
+        case ProtoType::Float:
+        case ProtoType::Fixed32:
+        case ProtoType::SFixed32:
+            return WireType::Fixed32;
+        case ProtoType::String:
+        case ProtoType::Bytes:
+        case ProtoType::Message:
+            return WireType::Bytes;
+        default:
+            return WireType::Varint;
+    }
+}
+
+template <typename T>
+constexpr bool isBlob = std::is_same_v<T, std::string> || std::is_same_v<T, std::vector<unsigned char>>;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr bool LittleEndian = true;
+#else
+constexpr bool LittleEndian = false;
+#endif
+
+/// Returns size of the fixed width value of the field type, 0 for varints and length delimited
+constexpr size_t fixedSize(ProtoType type)
+{
+    switch (wireTypeOf(type)) {
+        case WireType::Fixed64:
+            return 8;
+        case WireType::Fixed32:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+/// Checks if values of `T` in memory are exactly the same as packed values of the field type, so they could be copied
+/// at once
+template <ProtoType Proto, typename T>
+constexpr bool isRawPackable()
+{
+    if constexpr (!LittleEndian || fixedSize(Proto) != sizeof(T)) {
+        return false;
+    } else if constexpr (Proto == ProtoType::Double || Proto == ProtoType::Float) {
+        return std::is_floating_point_v<T>;
+    } else {
+        return std::is_integral_v<T> && !std::is_same_v<T, bool>;
+    }
+}
+
+template <typename To, typename From>
+To bitCast(const From& from)
+{
+    static_assert(sizeof(To) == sizeof(From));
+    To to;
+    std::memcpy(&to, &from, sizeof(To));
+    return to;
+}
+
+/// Checks if value is default one, it is not written for the proto3 singular fields
+template <typename T>
+bool isDefault(const T& val)
+{
+    if constexpr (std::is_same_v<T, double>) {
+        return bitCast<uint64_t>(val) == 0;
+    } else if constexpr (std::is_same_v<T, float>) {
+        return bitCast<uint32_t>(val) == 0;
+    } else {
+        return val == T{};
+    }
+}
+
+// =========================================================================================================================================
+
+inline void writeVarint(std::string& out, uint64_t val)
+{
+    while (val >= 0x80) {
+        out.push_back(char(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(char(val));
+}
+
+inline void writeFixed(std::string& out, uint64_t val, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        out.push_back(char(val >> (8 * i)));
+    }
+}
+
+inline void writeTag(std::string& out, int number, WireType type)
+{
+    writeVarint(out, (uint64_t(number) << 3) | uint64_t(type));
+}
+
+/// Starts length delimited content: one byte is reserved for the length, it is enough for the most of the messages
+inline size_t openLength(std::string& out)
+{
+    out.push_back(0);
+    return out.size();
+}
+
+/// Writes length of the content started at `start`, content is moved if the length takes more than one byte
+inline void closeLength(std::string& out, size_t start)
+{
+    size_t len = out.size() - start;
+    if (len < 0x80) {
+        out[start - 1] = char(len);
+        return;
+    }
+
+    std::string varint;
+    writeVarint(varint, len);
+    out.replace(start - 1, 1, varint);
+}
+
+/// Writes single value (without tag) as the field type requires
+template <ProtoType Proto, typename T>
+void write(std::string& out, const T& val)
+{
+    if constexpr (Proto == ProtoType::String || Proto == ProtoType::Bytes) {
+        if constexpr (isBlob<T>) {
+            writeVarint(out, val.size());
+            out.append(val.begin(), val.end());
+        } else {
+            throw std::runtime_error("Value is not a string");
+        }
+    } else if constexpr (isBlob<T> || Proto == ProtoType::Message) {
+        throw std::runtime_error("Value is not a number");
+    } else if constexpr (Proto == ProtoType::Double) {
+        writeFixed(out, bitCast<uint64_t>(double(val)), 8);
+    } else if constexpr (Proto == ProtoType::Float) {
+        writeFixed(out, bitCast<uint32_t>(float(val)), 4);
+    } else if constexpr (Proto == ProtoType::Fixed64 || Proto == ProtoType::SFixed64) {
+        writeFixed(out, uint64_t(val), 8);
+    } else if constexpr (Proto == ProtoType::Fixed32 || Proto == ProtoType::SFixed32) {
+        writeFixed(out, uint32_t(val), 4);
+    } else if constexpr (Proto == ProtoType::Int32 || Proto == ProtoType::Enum) {
+        writeVarint(out, uint64_t(int64_t(int32_t(val))));
+    } else if constexpr (Proto == ProtoType::Int64 || Proto == ProtoType::UInt64) {
+        writeVarint(out, uint64_t(val));
+    } else if constexpr (Proto == ProtoType::UInt32) {
+        writeVarint(out, uint32_t(val));
+    } else if constexpr (Proto == ProtoType::Bool) {
+        writeVarint(out, val ? 1 : 0);
+    } else if constexpr (Proto == ProtoType::SInt32) {
+        writeVarint(out, (uint32_t(int32_t(val)) << 1) ^ uint32_t(int32_t(val) >> 31));
+    } else if constexpr (Proto == ProtoType::SInt64) {
+        writeVarint(out, (uint64_t(int64_t(val)) << 1) ^ uint64_t(int64_t(val) >> 63));
+    }
+}
+
+/// Writes tag and value of the field
+template <ProtoType Proto, typename T>
+void writeField(std::string& out, int number, const T& val)
+{
+    writeTag(out, number, wireTypeOf(Proto));
+    write<Proto>(out, val);
+}
+
+/// Writes packed values of the repeated field (length and values, without tag). Fixed width values are copied at once
+/// when the memory layout is the same.
+template <ProtoType Proto, typename T>
+void writePacked(std::string& out, const std::vector<T>& values)
+{
+    if constexpr (isRawPackable<Proto, T>()) {
+        writeVarint(out, values.size() * sizeof(T));
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    } else if constexpr (fixedSize(Proto) != 0) {
+        writeVarint(out, values.size() * fixedSize(Proto));
+        out.reserve(out.size() + values.size() * fixedSize(Proto));
+        for (const auto& it : values) {
+            write<Proto>(out, T(it));
+        }
+    } else {
+        size_t start = openLength(out);
+        for (const auto& it : values) {
+            write<Proto>(out, T(it));
+        }
+        closeLength(out, start);
+    }
+}
+
+// =========================================================================================================================================
+
+// Sizes of the written content, the same as the writers above produce, so the message size is known without encoding
+
+inline size_t varintSize(uint64_t val)
+{
+    size_t size = 1;
+    while (val >= 0x80) {
+        val >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline size_t tagSize(int number)
+{
+    return varintSize(uint64_t(number) << 3);
+}
+
+/// Size of length delimited content together with its length
+inline size_t lengthSize(size_t len)
+{
+    return varintSize(len) + len;
+}
+
+/// Size of single value (without tag), see write()
+template <ProtoType Proto, typename T>
+size_t valueSize(const T& val)
+{
+    if constexpr (Proto == ProtoType::String || Proto == ProtoType::Bytes) {
+        if constexpr (isBlob<T>) {
+            return lengthSize(val.size());
+        } else {
+            throw std::runtime_error("Value is not a string");
+        }
+    } else if constexpr (isBlob<T> || Proto == ProtoType::Message) {
+        throw std::runtime_error("Value is not a number");
+    } else if constexpr (fixedSize(Proto) != 0) {
+        return fixedSize(Proto);
+    } else if constexpr (Proto == ProtoType::Int32 || Proto == ProtoType::Enum) {
+        return varintSize(uint64_t(int64_t(int32_t(val))));
+    } else if constexpr (Proto == ProtoType::Int64 || Proto == ProtoType::UInt64) {
+        return varintSize(uint64_t(val));
+    } else if constexpr (Proto == ProtoType::UInt32) {
+        return varintSize(uint32_t(val));
+    } else if constexpr (Proto == ProtoType::Bool) {
+        return 1;
+    } else if constexpr (Proto == ProtoType::SInt32) {
+        return varintSize((uint32_t(int32_t(val)) << 1) ^ uint32_t(int32_t(val) >> 31));
+    } else {
+        static_assert(Proto == ProtoType::SInt64);
+        return varintSize((uint64_t(int64_t(val)) << 1) ^ uint64_t(int64_t(val) >> 63));
+    }
+}
+
+/// Size of tag and value of the field, see writeField()
+template <ProtoType Proto, typename T>
+size_t fieldSize(int number, const T& val)
+{
+    return tagSize(number) + valueSize<Proto>(val);
+}
+
+/// Size of packed values with their length (without tag), see writePacked()
+template <ProtoType Proto, typename T>
+size_t packedSize(const std::vector<T>& values)
+{
+    if constexpr (fixedSize(Proto) != 0) {
+        return lengthSize(values.size() * fixedSize(Proto));
+    } else {
+        size_t size = 0;
+        for (const auto& it : values) {
+            size += valueSize<Proto>(T(it));
+        }
+        return lengthSize(size);
+    }
+}
+
+// =========================================================================================================================================
+
+/// Single field of the content: number, wire type and value. Value is an integer (varint and fixed types) or
+/// content (length delimited type)
+struct Field
+{
+    int              number = 0;
+    WireType         type   = WireType::Varint;
+    uint64_t         value  = 0;
+    std::string_view bytes;
+};
+
+/// Reads fields of the message content one by one
+class Reader
+{
+public:
+    Reader(std::string_view content)
+        : m_pos(content.data())
+        , m_end(content.data() + content.size())
+    {
+    }
+
+    bool atEnd() const
+    {
+        return m_pos == m_end;
+    }
+
+    /// Reads next field, returns false at the end of content
+    bool next(Field& field)
+    {
+        if (atEnd()) {
+            return false;
+        }
+
+        uint64_t tag = varint();
+        field.number = int(tag >> 3);
+        field.type   = WireType(tag & 7);
+        if (field.number == 0) {
+            throw std::runtime_error("Broken protobuf content: zero field number");
+        }
+        read(field);
+        return true;
+    }
+
+    /// Reads next varint length prefixed message of the delimited stream, returns false at the end of content
+    bool nextDelimited(std::string_view& message)
+    {
+        if (atEnd()) {
+            return false;
+        }
+
+        uint64_t len = varint();
+        if (len > uint64_t(m_end - m_pos)) {
+            throw std::runtime_error("Broken protobuf content: truncated message");
+        }
+        message = std::string_view(m_pos, size_t(len));
+        m_pos += len;
+        return true;
+    }
+
+    /// Reads value of the field by its wire type
+    void read(Field& field)
+    {
+        switch (field.type) {
+            case WireType::Varint:
+                field.value = varint();
+                break;
+            case WireType::Fixed64:
+                field.value = fixed(8);
+                break;
+            case WireType::Fixed32:
+                field.value = fixed(4);
+                break;
+            case WireType::Bytes: {
+                uint64_t len = varint();
+                if (len > uint64_t(m_end - m_pos)) {
+                    throw std::runtime_error("Broken protobuf content: truncated field " + std::to_string(field.number));
+                }
+                field.bytes = std::string_view(m_pos, size_t(len));
+                m_pos += len;
+                break;
+            }
+            default:
+                throw std::runtime_error("Unsupported wire type of field " + std::to_string(field.number));
+        }
+    }
+
+private:
+    uint64_t varint()
+    {
+        uint64_t val = 0;
+        for (int shift = 0; shift < 64 && m_pos != m_end; shift += 7) {
+            auto byte = uint8_t(*m_pos++);
+            val |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return val;
+            }
+        }
+        throw std::runtime_error("Broken protobuf content: malformed varint");
+    }
+
+    uint64_t fixed(size_t size)
+    {
+        if (size > size_t(m_end - m_pos)) {
+            throw std::runtime_error("Broken protobuf content: truncated fixed value");
+        }
+        uint64_t val = 0;
+        for (size_t i = 0; i < size; ++i) {
+            val |= uint64_t(uint8_t(*m_pos++)) << (8 * i);
+        }
+        return val;
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+};
+
+/// Returns single value of the field as `T`
+template <ProtoType Proto, typename T>
+T read(const Field& field)
+{
+    if (field.type != wireTypeOf(Proto)) {
+        throw std::runtime_error("Wrong wire type of field " + std::to_string(field.number));
+    }
+
+    if constexpr (Proto == ProtoType::String || Proto == ProtoType::Bytes) {
+        if constexpr (isBlob<T>) {
+            return T(field.bytes.begin(), field.bytes.end());
+        } else {
+            throw std::runtime_error("Field " + std::to_string(field.number) + " is a string");
+        }
+    } else if constexpr (isBlob<T> || Proto == ProtoType::Message) {
+        throw std::runtime_error("Field " + std::to_string(field.number) + " is not a string");
+    } else if constexpr (Proto == ProtoType::Double) {
+        return static_cast<T>(bitCast<double>(field.value));
+    } else if constexpr (Proto == ProtoType::Float) {
+        return static_cast<T>(bitCast<float>(uint32_t(field.value)));
+    } else if constexpr (Proto == ProtoType::Int64 || Proto == ProtoType::SFixed64) {
+        return static_cast<T>(int64_t(field.value));
+    } else if constexpr (Proto == ProtoType::UInt64 || Proto == ProtoType::Fixed64) {
+        return static_cast<T>(field.value);
+    } else if constexpr (Proto == ProtoType::Int32 || Proto == ProtoType::SFixed32 || Proto == ProtoType::Enum) {
+        return static_cast<T>(int32_t(field.value));
+    } else if constexpr (Proto == ProtoType::UInt32 || Proto == ProtoType::Fixed32) {
+        return static_cast<T>(uint32_t(field.value));
+    } else if constexpr (Proto == ProtoType::Bool) {
+        return static_cast<T>(field.value != 0);
+    } else if constexpr (Proto == ProtoType::SInt32) {
+        return static_cast<T>(int32_t(uint32_t(field.value) >> 1) ^ -int32_t(field.value & 1));
+    } else {
+        return static_cast<T>(int64_t(field.value >> 1) ^ -int64_t(field.value & 1));
+    }
+}
+
+/// Reads repeated value of the field into the list, packed or not. Packed fixed width values are copied at once when
+/// the memory layout is the same, for others memory is reserved first.
+template <ProtoType Proto, typename List>
+void readList(const Field& field, List& list)
+{
+    using CppType = typename List::CppType;
+
+    if (field.type == WireType::Bytes && wireTypeOf(Proto) != WireType::Bytes) {
+        if (fixedSize(Proto) != 0 && field.bytes.size() % fixedSize(Proto) != 0) {
+            throw std::runtime_error("Broken protobuf content: wrong size of packed field " + std::to_string(field.number));
+        }
+
+        if constexpr (isRawPackable<Proto, CppType>()) {
+            std::memcpy(list.extend(int(field.bytes.size() / sizeof(CppType))), field.bytes.data(), field.bytes.size());
+            return;
+        } else if constexpr (fixedSize(Proto) != 0) {
+            list.reserve(list.size() + int(field.bytes.size() / fixedSize(Proto)));
+        } else {
+            // Every varint ends with the byte without continuation bit
+            size_t count = 0;
+            for (char ch : field.bytes) {
+                count += (uint8_t(ch) & 0x80) ? 0 : 1;
+            }
+            list.reserve(list.size() + int(count));
+        }
+
+        Reader reader(field.bytes);
+        Field  value;
+        value.number = field.number;
+        value.type   = wireTypeOf(Proto);
+        while (!reader.atEnd()) {
+            reader.read(value);
+            list.append(read<Proto, CppType>(value));
+        }
+    } else {
+        list.append(read<Proto, CppType>(field));
+    }
+}
+
+/// Returns content of the message field
+inline std::string_view content(const Field& field)
+{
+    if (field.type != WireType::Bytes) {
+        throw std::runtime_error("Field " + std::to_string(field.number) + " is not a message");
+    }
+    return field.bytes;
+}
+
+// =========================================================================================================================================
+
+} // namespace pack::wire
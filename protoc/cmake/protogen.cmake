@@ -1,7 +1,7 @@
 find_package(Protobuf COMPONENTS protoc)
 macro(fty_protogen)
     cmake_parse_arguments(arg
-        ""
+        "WIRE_CODEC"
         "TARGET;WORKDIR"
         "PROTO"
         ${ARGN}
@@ -24,6 +24,11 @@ macro(fty_protogen)
         endif()
     endif()
 
+    set(params)
+    if (arg_WIRE_CODEC)
+        set(params wire_codec:)
+    endif()
+
     foreach(proto ${arg_PROTO})
         get_filename_component(outDir ${proto} DIRECTORY)
         get_filename_component(abs ${proto} ABSOLUTE)
@@ -44,7 +49,7 @@ macro(fty_protogen)
 
         add_custom_command(
             OUTPUT  ${result}
-            COMMAND ${protoc} --plugin=${plugin} -I ${inc} --fty_out=${CMAKE_CURRENT_BINARY_DIR}/${outDir} ${abs}
+            COMMAND ${protoc} --plugin=${plugin} -I ${inc} --fty_out=${params}${CMAKE_CURRENT_BINARY_DIR}/${outDir} ${abs}
             DEPENDS ${plugin} ${proto}
         )
         target_sources(${arg_TARGET} PRIVATE ${result})
@@ -20,15 +20,19 @@
 
 #include "classgenerator.h"
 #include "formatter.h"
+#include <algorithm>
 #include <fty/string-utils.h>
 #include <google/protobuf/descriptor.pb.h>
 #include <google/protobuf/extension_set.h>
 #include <iostream>
+#include <map>
+#include <set>
 
 namespace google::protobuf::compiler::fty {
 
-ClassGenerator::ClassGenerator(const Descriptor* desc)
+ClassGenerator::ClassGenerator(const Descriptor* desc, bool wireCodec)
     : m_desc(desc)
+    , m_wireCodec(wireCodec)
 {
 }
 
@@ -92,6 +96,63 @@ static std::vector<const FieldDescriptor*> getExtensions(const FileDescriptor* f
     return ret;
 }
 
+/// Checks if wire codec could be generated: all the fields are supported and nested messages are from the same file,
+/// so they have codecs too
+static bool codecSupported(const Descriptor* desc, std::set<const Descriptor*>& visited)
+{
+    if (!visited.insert(desc).second) {
+        return true;
+    }
+
+    for (int i = 0; i < desc->field_count(); ++i) {
+        const auto& fld = desc->field(i);
+        if (fld->type() == FieldDescriptor::TYPE_GROUP) {
+            return false;
+        }
+        if (fld->is_repeated() && !fld->is_map() &&
+            (fld->type() == FieldDescriptor::TYPE_BYTES || fld->type() == FieldDescriptor::TYPE_BOOL ||
+                fld->type() == FieldDescriptor::TYPE_ENUM)) {
+            return false;
+        }
+        if (fld->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+            (fld->message_type()->file() != desc->file() || !codecSupported(fld->message_type(), visited))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string protoType(const FieldDescriptor* fld)
+{
+    static const std::map<FieldDescriptor::Type, std::string> names = {
+        {FieldDescriptor::TYPE_DOUBLE, "Double"},
+        {FieldDescriptor::TYPE_FLOAT, "Float"},
+        {FieldDescriptor::TYPE_INT64, "Int64"},
+        {FieldDescriptor::TYPE_UINT64, "UInt64"},
+        {FieldDescriptor::TYPE_INT32, "Int32"},
+        {FieldDescriptor::TYPE_FIXED64, "Fixed64"},
+        {FieldDescriptor::TYPE_FIXED32, "Fixed32"},
+        {FieldDescriptor::TYPE_BOOL, "Bool"},
+        {FieldDescriptor::TYPE_STRING, "String"},
+        {FieldDescriptor::TYPE_MESSAGE, "Message"},
+        {FieldDescriptor::TYPE_BYTES, "Bytes"},
+        {FieldDescriptor::TYPE_UINT32, "UInt32"},
+        {FieldDescriptor::TYPE_ENUM, "Enum"},
+        {FieldDescriptor::TYPE_SFIXED32, "SFixed32"},
+        {FieldDescriptor::TYPE_SFIXED64, "SFixed64"},
+        {FieldDescriptor::TYPE_SINT32, "SInt32"},
+        {FieldDescriptor::TYPE_SINT64, "SInt64"},
+    };
+    return "::pack::wire::ProtoType::" + names.at(fld->type());
+}
+
+/// Default value of the field is not written (proto3 singular scalar)
+static bool isImplicit(const FieldDescriptor* fld)
+{
+    return !fld->is_repeated() && !fld->containing_oneof() && fld->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE &&
+           fld->file()->syntax() == FileDescriptor::SYNTAX_PROTO3;
+}
+
 void ClassGenerator::generateHeader(Formatter& frm, const std::string& descNamespace, bool asMap) const
 {
     frm << "class " << m_desc->name() << ": public pack::Node"
@@ -134,7 +195,7 @@ void ClassGenerator::generateHeader(Formatter& frm, const std::string& descNames
                 }
             }
 
-            ClassGenerator nested(type);
+            ClassGenerator nested(type, m_wireCodec);
             nested.generateHeader(frm, descNamespace, usedInMap);
         }
     }
@@ -244,6 +305,11 @@ void ClassGenerator::generateHeader(Formatter& frm, const std::string& descNames
     frm << "return \"" << m_desc->full_name() << "\";\n";
     frm.outdent();
     frm << "}\n\n";
+
+    std::set<const Descriptor*> visited;
+    if (m_wireCodec && codecSupported(m_desc, visited)) {
+        generateCodec(frm);
+    }
     frm.outdent();
 
     if (m_desc->oneof_decl_count()) {
@@ -267,6 +333,203 @@ void ClassGenerator::generateHeader(Formatter& frm, const std::string& descNames
     frm << "\n";
 }
 
+/// Generates straight-line protobuf encoder, size counter and decoder of the message, the same wire format as protobuf provider
+/// writes and reads by the descriptor
+void ClassGenerator::generateCodec(Formatter& frm) const
+{
+    frm << "bool encodeProto(std::string& out_) const override\n";
+    frm << "{\n";
+    frm.indent();
+    for (int i = 0; i < m_desc->field_count(); ++i) {
+        const auto& fld    = m_desc->field(i);
+        std::string name   = fld->camelcase_name();
+        std::string number = std::to_string(fld->number());
+
+        if (fld->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+            if (fld->is_repeated()) {
+                frm << "for (const auto& it_ : " << name << ") {\n";
+            } else {
+                frm << "if (" << name << ".hasValue()) {\n";
+            }
+            frm.indent();
+            frm << "::pack::wire::writeTag(out_, " << number << ", ::pack::wire::WireType::Bytes);\n";
+            frm << "size_t start_ = ::pack::wire::openLength(out_);\n";
+            frm << (fld->is_repeated() ? "it_" : name) << ".encodeProto(out_);\n";
+            frm << "::pack::wire::closeLength(out_, start_);\n";
+            frm.outdent();
+            frm << "}\n";
+        } else if (fld->is_repeated() && fld->is_packed()) {
+            frm << "if (" << name << ".hasValue()) {\n";
+            frm.indent();
+            frm << "::pack::wire::writeTag(out_, " << number << ", ::pack::wire::WireType::Bytes);\n";
+            frm << "::pack::wire::writePacked<" << protoType(fld) << ">(out_, " << name << ".value());\n";
+            frm.outdent();
+            frm << "}\n";
+        } else if (fld->is_repeated()) {
+            frm << "for (const auto& it_ : " << name << ") {\n";
+            frm.indent();
+            frm << "::pack::wire::writeField<" << protoType(fld) << ">(out_, " << number << ", it_);\n";
+            frm.outdent();
+            frm << "}\n";
+        } else if (fld->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+            frm << "if (" << name << ".hasValue()" << (isImplicit(fld) ? " && " + name + ".asInt() != 0" : "") << ") {\n";
+            frm.indent();
+            frm << "::pack::wire::writeField<" << protoType(fld) << ">(out_, " << number << ", " << name << ".asInt());\n";
+            frm.outdent();
+            frm << "}\n";
+        } else {
+            bool implicit = isImplicit(fld) && fld->type() != FieldDescriptor::TYPE_BYTES;
+            frm << "if (" << name << ".hasValue()" << (implicit ? " && !::pack::wire::isDefault(" + name + ".value())" : "")
+                << ") {\n";
+            frm.indent();
+            frm << "::pack::wire::writeField<" << protoType(fld) << ">(out_, " << number << ", " << name << ".value());\n";
+            frm.outdent();
+            frm << "}\n";
+        }
+    }
+    frm << "return true;\n";
+    frm.outdent();
+    frm << "}\n\n";
+
+    frm << "bool protoSize(size_t& size_) const override\n";
+    frm << "{\n";
+    frm.indent();
+    frm << "size_ = 0;\n";
+    for (int i = 0; i < m_desc->field_count(); ++i) {
+        const auto& fld    = m_desc->field(i);
+        std::string name   = fld->camelcase_name();
+        std::string number = std::to_string(fld->number());
+
+        if (fld->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+            if (fld->is_repeated()) {
+                frm << "for (const auto& it_ : " << name << ") {\n";
+            } else {
+                frm << "if (" << name << ".hasValue()) {\n";
+            }
+            frm.indent();
+            frm << "size_t sub_ = 0;\n";
+            frm << (fld->is_repeated() ? "it_" : name) << ".protoSize(sub_);\n";
+            frm << "size_ += ::pack::wire::tagSize(" << number << ") + ::pack::wire::lengthSize(sub_);\n";
+            frm.outdent();
+            frm << "}\n";
+        } else if (fld->is_repeated() && fld->is_packed()) {
+            frm << "if (" << name << ".hasValue()) {\n";
+            frm.indent();
+            frm << "size_ += ::pack::wire::tagSize(" << number << ") + ::pack::wire::packedSize<" << protoType(fld) << ">(" << name
+                << ".value());\n";
+            frm.outdent();
+            frm << "}\n";
+        } else if (fld->is_repeated()) {
+            frm << "for (const auto& it_ : " << name << ") {\n";
+            frm.indent();
+            frm << "size_ += ::pack::wire::fieldSize<" << protoType(fld) << ">(" << number << ", it_);\n";
+            frm.outdent();
+            frm << "}\n";
+        } else if (fld->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+            frm << "if (" << name << ".hasValue()" << (isImplicit(fld) ? " && " + name + ".asInt() != 0" : "") << ") {\n";
+            frm.indent();
+            frm << "size_ += ::pack::wire::fieldSize<" << protoType(fld) << ">(" << number << ", " << name << ".asInt());\n";
+            frm.outdent();
+            frm << "}\n";
+        } else {
+            bool implicit = isImplicit(fld) && fld->type() != FieldDescriptor::TYPE_BYTES;
+            frm << "if (" << name << ".hasValue()" << (implicit ? " && !::pack::wire::isDefault(" + name + ".value())" : "")
+                << ") {\n";
+            frm.indent();
+            frm << "size_ += ::pack::wire::fieldSize<" << protoType(fld) << ">(" << number << ", " << name << ".value());\n";
+            frm.outdent();
+            frm << "}\n";
+        }
+    }
+    frm << "return true;\n";
+    frm.outdent();
+    frm << "}\n\n";
+
+    // Singular fields which are set to default if they are not in the content, repeated ones are replaced
+    std::vector<const FieldDescriptor*> resettable;
+    std::vector<const FieldDescriptor*> repeated;
+    for (int i = 0; i < m_desc->field_count(); ++i) {
+        const auto& fld = m_desc->field(i);
+        (fld->is_repeated() ? repeated : resettable).push_back(fld);
+    }
+    auto seen = [&](const FieldDescriptor* fld) {
+        auto it = std::find(resettable.begin(), resettable.end(), fld);
+        return "seen_[" + std::to_string(std::distance(resettable.begin(), it)) + "] = true;\n";
+    };
+
+    frm << "bool decodeProto(std::string_view content_) override\n";
+    frm << "{\n";
+    frm.indent();
+    if (!resettable.empty()) {
+        frm << "bool seen_[" << resettable.size() << "] = {};\n";
+    }
+    for (const auto& fld : repeated) {
+        frm << fld->camelcase_name() << ".clear();\n";
+    }
+    frm << "::pack::wire::Reader reader_(content_);\n";
+    frm << "::pack::wire::Field  field_;\n";
+    frm << "while (reader_.next(field_)) {\n";
+    frm.indent();
+    frm << "switch (field_.number) {\n";
+    for (int i = 0; i < m_desc->field_count(); ++i) {
+        const auto& fld  = m_desc->field(i);
+        std::string name = fld->camelcase_name();
+
+        frm << "case " << fld->number() << ":\n";
+        frm.indent();
+        if (fld->is_map()) {
+            frm << name << ".create().decodeProto(::pack::wire::content(field_));\n";
+        } else if (fld->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE && fld->is_repeated()) {
+            frm << name << ".append().decodeProto(::pack::wire::content(field_));\n";
+        } else if (fld->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+            frm << name << ".decodeProto(::pack::wire::content(field_));\n";
+            frm << seen(fld);
+        } else if (fld->is_repeated()) {
+            frm << "::pack::wire::readList<" << protoType(fld) << ">(field_, " << name << ");\n";
+        } else if (fld->type() == FieldDescriptor::TYPE_BYTES) {
+            frm << name << ".setValue(::pack::wire::read<" << protoType(fld) << ", std::vector<unsigned char>>(field_));\n";
+            frm << seen(fld);
+        } else if (fld->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+            frm << name << ".fromInt(::pack::wire::read<" << protoType(fld) << ", int>(field_));\n";
+            frm << seen(fld);
+        } else {
+            frm << name << " = ::pack::wire::read<" << protoType(fld) << ", " << usingType(fld) << ">(field_);\n";
+            frm << seen(fld);
+        }
+        frm << "break;\n";
+        frm.outdent();
+    }
+    frm << "default:\n";
+    frm.indent();
+    frm << "break;\n";
+    frm.outdent();
+    frm << "}\n";
+    frm.outdent();
+    frm << "}\n";
+
+    for (size_t i = 0; i < resettable.size(); ++i) {
+        const auto& fld  = resettable[i];
+        std::string name = fld->camelcase_name();
+
+        frm << "if (!seen_[" << i << "]) {\n";
+        frm.indent();
+        if (fld->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+            frm << name << ".decodeProto({});\n";
+        } else if (fld->type() == FieldDescriptor::TYPE_BYTES) {
+            frm << name << ".clear();\n";
+        } else if (fld->cpp_type() == FieldDescriptor::CPPTYPE_ENUM) {
+            frm << name << ".fromInt(0);\n";
+        } else {
+            frm << name << " = " << usingType(fld) << "{};\n";
+        }
+        frm.outdent();
+        frm << "}\n";
+    }
+    frm << "return true;\n";
+    frm.outdent();
+    frm << "}\n\n";
+}
+
 std::string ClassGenerator::cppType(const FieldDescriptor* fld) const
 {
     using namespace std::string_literals;
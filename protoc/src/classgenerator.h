@@ -27,7 +27,7 @@ class Formatter;
 class ClassGenerator
 {
 public:
-    ClassGenerator(const Descriptor* desc);
+    ClassGenerator(const Descriptor* desc, bool wireCodec = false);
 
     const Descriptor* descriptor() const;
 
@@ -35,9 +35,11 @@ public:
 
 private:
     std::string cppType(const FieldDescriptor* fld) const;
+    void        generateCodec(Formatter& frm) const;
 
 private:
     const Descriptor* m_desc;
+    bool              m_wireCodec;
 };
 
 } // namespace google::protobuf::compiler::fty
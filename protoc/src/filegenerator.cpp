@@ -46,8 +46,9 @@ static std::vector<const Descriptor*> FlattenMessagesInFile(const FileDescriptor
     return result;
 }
 
-FileGenerator::FileGenerator(const FileDescriptor* file)
+FileGenerator::FileGenerator(const FileDescriptor* file, bool wireCodec)
     : m_file(file)
+    , m_wireCodec(wireCodec)
 {
     std::vector<const Descriptor*> msgs = FlattenMessagesInFile(m_file);
     for (const auto& msg : msgs) {
@@ -66,6 +67,9 @@ void FileGenerator::generateHeader(io::Printer& printer) const
         frm << "#include \"" << genFileName(dep) << "\"\n";
     }
     frm << "#include <pack/pack.h>\n";
+    if (m_wireCodec) {
+        frm << "#include <pack/wire.h>\n";
+    }
     frm << "\n";
 
     std::string path  = "file";
@@ -84,10 +88,11 @@ void FileGenerator::generateHeader(io::Printer& printer) const
         }
     }
 
+    std::string       descriptor = getDescriptor();
     std::stringstream ss;
     bool              wasText = false;
     bool              wasHex  = false;
-    for (const char& ch : getDescriptor()) {
+    for (const char& ch : descriptor) {
         if (std::isalnum(ch)) {
             ss << (wasHex ? "\" \"" : "") << ch;
             wasText = true;
@@ -110,10 +115,11 @@ void FileGenerator::generateHeader(io::Printer& printer) const
     frm << "inline const std::string& descriptor()\n";
     frm << "{\n";
     frm.indent();
-    frm << "static std::string desc(\"" << ss.str() << "\", " << ss.str().size() << ");\n";
+    frm << "static std::string desc(\"" << ss.str() << "\", " << descriptor.size() << ");\n";
     frm << "return desc;\n";
     frm.outdent();
-    frm << "}\n";
+    frm << "}\n\n";
+    frm << "inline const bool registered = ::pack::registerFileDescriptor(&descriptor);\n";
     frm << "}\n\n";
 
     frm << "// "
@@ -128,7 +134,7 @@ void FileGenerator::generateHeader(io::Printer& printer) const
     }
 
     for (int i = 0; i < m_file->message_type_count(); i++) {
-        ClassGenerator gen(m_file->message_type(i));
+        ClassGenerator gen(m_file->message_type(i), m_wireCodec);
         gen.generateHeader(frm, path);
     }
 
@@ -30,7 +30,7 @@ class ClassGenerator;
 class FileGenerator
 {
 public:
-    FileGenerator(const FileDescriptor* file);
+    FileGenerator(const FileDescriptor* file, bool wireCodec = false);
     ~FileGenerator();
 
     void        generateHeader(io::Printer& printer) const;
@@ -38,6 +38,7 @@ public:
 
 private:
     const FileDescriptor*       m_file;
+    bool                        m_wireCodec;
     std::vector<ClassGenerator> m_generators;
 };
 
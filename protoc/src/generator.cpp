@@ -30,10 +30,11 @@ Generator::Generator()
 {
 }
 
-bool Generator::Generate(const FileDescriptor* file, const std::string& /*parameter*/,
+bool Generator::Generate(const FileDescriptor* file, const std::string& parameter,
     GeneratorContext*                          context, std::string* /*error*/) const
 {
-    FileGenerator generator(file);
+    // --fty_out=wire_codec:<dir> generates protobuf encoder/decoder for every message
+    FileGenerator generator(file, parameter.find("wire_codec") != std::string::npos);
 
     {
         std::string                               fileName = genFileName(file);
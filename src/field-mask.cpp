@@ -0,0 +1,169 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#include "pack/field-mask.h"
+#include "pack/node.h"
+#include <atomic>
+#include <unordered_map>
+
+// =========================================================================================================================================
+
+static thread_local const pack::FieldMask* activeMask = nullptr;
+
+pack::FieldMask::Scope::Scope(const FieldMask* mask)
+    : m_prev(activeMask)
+{
+    activeMask = mask;
+}
+
+pack::FieldMask::Scope::~Scope()
+{
+    activeMask = m_prev;
+}
+
+// =========================================================================================================================================
+
+pack::FieldMask::FieldMask(std::initializer_list<std::string> paths)
+{
+    for (const auto& it : paths) {
+        add(it);
+    }
+}
+
+pack::FieldMask::FieldMask(const std::vector<std::string>& paths)
+{
+    for (const auto& it : paths) {
+        add(it);
+    }
+}
+
+pack::FieldMask::FieldMask(const FieldMask& other)
+    : m_whole(other.m_whole)
+    , m_children(other.m_children)
+{
+}
+
+pack::FieldMask& pack::FieldMask::operator=(const FieldMask& other)
+{
+    if (this != &other) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_version  = nextVersion();
+        m_whole    = other.m_whole;
+        m_children = other.m_children;
+        m_compiled.clear();
+    }
+    return *this;
+}
+
+void pack::FieldMask::add(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_version = nextVersion();
+    m_compiled.clear();
+
+    FieldMask* current = this;
+    size_t     pos     = 0;
+    while (pos <= path.size()) {
+        size_t next = path.find('.', pos);
+        if (next == std::string::npos) {
+            next = path.size();
+        }
+
+        FieldMask& child = current->m_children[path.substr(pos, next - pos)];
+        if (child.m_whole) {
+            // Already selected with all the subtree
+            return;
+        }
+        if (next == path.size()) {
+            child.m_whole = true;
+            child.m_children.clear();
+            return;
+        }
+        current = &child;
+        pos     = next + 1;
+    }
+}
+
+bool pack::FieldMask::empty() const
+{
+    return m_whole || m_children.empty();
+}
+
+const pack::FieldMask* pack::FieldMask::find(const std::string& key) const
+{
+    auto it = m_children.find(key);
+    return it != m_children.end() ? &it->second : nullptr;
+}
+
+uint64_t pack::FieldMask::nextVersion()
+{
+    static std::atomic<uint64_t> version{0};
+    return ++version;
+}
+
+const pack::FieldMask::Selection& pack::FieldMask::select(const INode& node) const
+{
+    using Key = std::pair<uint64_t, std::type_index>;
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<uint64_t>()(key.first) ^ key.second.hash_code();
+        }
+    };
+
+    // Version is unique for every content of every mask, so entries of the changed or removed masks are never hit
+    static constexpr size_t                                         MaxCached = 1024;
+    thread_local std::unordered_map<Key, const Selection*, KeyHash> cache;
+
+    Key key{m_version, typeid(node)};
+    if (auto it = cache.find(key); it != cache.end()) {
+        return *it->second;
+    }
+    if (cache.size() >= MaxCached) {
+        cache.clear();
+    }
+
+    const Selection& sel = compile(node);
+    cache.emplace(key, &sel);
+    return sel;
+}
+
+const pack::FieldMask::Selection& pack::FieldMask::compile(const INode& node) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto found = m_compiled.find(typeid(node));
+    if (found != m_compiled.end()) {
+        return found->second;
+    }
+
+    Selection sel;
+    for (const auto* it : node.fields()) {
+        auto child = m_children.find(it->key());
+        sel.fields.push_back(child != m_children.end());
+        sel.children.push_back(child != m_children.end() && !child->second.empty() ? &child->second : nullptr);
+    }
+    return m_compiled.emplace(typeid(node), std::move(sel)).first->second;
+}
+
+const pack::FieldMask* pack::FieldMask::active()
+{
+    return activeMask;
+}
+
+// =========================================================================================================================================
@@ -0,0 +1,278 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#include "pack/fingerprint.h"
+#include "pack/pack.h"
+#include "pack/visitor.h"
+#include <cstring>
+
+namespace pack {
+
+// =========================================================================================================================================
+
+/// Streaming xxHash64
+class XxHash64
+{
+public:
+    XxHash64()
+        : m_acc{Prime1 + Prime2, Prime2, 0, 0 - Prime1}
+    {
+    }
+
+    void update(const void* data, size_t size)
+    {
+        auto ptr = static_cast<const unsigned char*>(data);
+        m_total += size;
+
+        if (m_buffSize + size < sizeof(m_buff)) {
+            std::memcpy(m_buff + m_buffSize, ptr, size);
+            m_buffSize += size;
+            return;
+        }
+
+        if (m_buffSize) {
+            size_t fill = sizeof(m_buff) - m_buffSize;
+            std::memcpy(m_buff + m_buffSize, ptr, fill);
+            stripe(m_buff);
+            ptr += fill;
+            size -= fill;
+            m_buffSize = 0;
+        }
+
+        for (; size >= sizeof(m_buff); ptr += sizeof(m_buff), size -= sizeof(m_buff)) {
+            stripe(ptr);
+        }
+
+        std::memcpy(m_buff, ptr, size);
+        m_buffSize = size;
+    }
+
+    template <typename T>
+    void update(const T& val)
+    {
+        static_assert(std::is_arithmetic_v<T>);
+        update(&val, sizeof(T));
+    }
+
+    void update(const std::string& str)
+    {
+        update(uint64_t(str.size()));
+        update(str.data(), str.size());
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t hash;
+        if (m_total >= sizeof(m_buff)) {
+            hash = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) + rotl(m_acc[3], 18);
+            for (uint64_t acc : m_acc) {
+                hash = (hash ^ round(0, acc)) * Prime1 + Prime4;
+            }
+        } else {
+            hash = Prime5;
+        }
+        hash += m_total;
+
+        const unsigned char* ptr = m_buff;
+        const unsigned char* end = m_buff + m_buffSize;
+        for (; ptr + 8 <= end; ptr += 8) {
+            hash ^= round(0, read<uint64_t>(ptr));
+            hash = rotl(hash, 27) * Prime1 + Prime4;
+        }
+        if (ptr + 4 <= end) {
+            hash ^= read<uint32_t>(ptr) * Prime1;
+            hash = rotl(hash, 23) * Prime2 + Prime3;
+            ptr += 4;
+        }
+        for (; ptr < end; ++ptr) {
+            hash ^= *ptr * Prime5;
+            hash = rotl(hash, 11) * Prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static constexpr uint64_t Prime1 = 11400714785074694791ULL;
+    static constexpr uint64_t Prime2 = 14029467366897019727ULL;
+    static constexpr uint64_t Prime3 = 1609587929392839161ULL;
+    static constexpr uint64_t Prime4 = 9650029242287828579ULL;
+    static constexpr uint64_t Prime5 = 2870177450012600261ULL;
+
+    static uint64_t rotl(uint64_t val, int bits)
+    {
+        return (val << bits) | (val >> (64 - bits));
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input)
+    {
+        return rotl(acc + input * Prime2, 31) * Prime1;
+    }
+
+    template <typename T>
+    static T read(const unsigned char* ptr)
+    {
+        T val;
+        std::memcpy(&val, ptr, sizeof(T));
+        return val;
+    }
+
+    void stripe(const unsigned char* ptr)
+    {
+        for (int i = 0; i < 4; ++i) {
+            m_acc[i] = round(m_acc[i], read<uint64_t>(ptr + i * 8));
+        }
+    }
+
+private:
+    uint64_t      m_acc[4];
+    unsigned char m_buff[32];
+    size_t        m_buffSize = 0;
+    uint64_t      m_total    = 0;
+};
+
+// =========================================================================================================================================
+
+template <Type ValType>
+struct HashValue
+{
+    using CppType = typename ResolveType<ValType>::type;
+
+    static void update(XxHash64& hash, const CppType& val)
+    {
+        if constexpr (ValType == Type::String) {
+            hash.update(val);
+        } else if constexpr (ValType == Type::Float || ValType == Type::Double) {
+            // -0.0 is equal to 0.0
+            hash.update(val == 0 ? CppType(0) : val);
+        } else {
+            hash.update(val);
+        }
+    }
+};
+
+// =========================================================================================================================================
+
+class Fingerprint : public Serialize<Fingerprint>
+{
+public:
+    template <Type ValType>
+    static void packValue(const Value<ValType>& val, XxHash64& hash, Option /*opt*/)
+    {
+        HashValue<ValType>::update(hash, val.value());
+    }
+
+    template <Type ValType>
+    static void packValue(const ValueList<ValType>& list, XxHash64& hash, Option /*opt*/)
+    {
+        hash.update(uint64_t(list.size()));
+        if constexpr (ValType == Type::UChar) {
+            hash.update(list.value().data(), list.value().size());
+        } else {
+            for (const auto& it : list) {
+                HashValue<ValType>::update(hash, it);
+            }
+        }
+    }
+
+    template <Type ValType>
+    static void packValue(const ValueMap<ValType>& map, XxHash64& hash, Option /*opt*/)
+    {
+        hash.update(uint64_t(map.size()));
+        for (const auto& [key, value] : map) {
+            hash.update(key);
+            HashValue<ValType>::update(hash, value);
+        }
+    }
+
+    static void packValue(const IObjectMap& map, XxHash64& hash, Option opt)
+    {
+        hash.update(uint64_t(map.size()));
+        for (int i = 0; i < map.size(); ++i) {
+            const auto& key = map.keyByIndex(i);
+            hash.update(key);
+            visit(map.get(key), hash, opt);
+        }
+    }
+
+    static void packValue(const IObjectList& list, XxHash64& hash, Option opt)
+    {
+        hash.update(uint64_t(list.size()));
+        for (int i = 0; i < list.size(); ++i) {
+            visit(list.get(i), hash, opt);
+        }
+    }
+
+    static void packValue(const INode& node, XxHash64& hash, Option opt)
+    {
+        eachField(node, [&](const Attribute& it) {
+            if (it.hasValue()) {
+                hash.update(it.key());
+                visit(it, hash, opt);
+            }
+        });
+        // End of the node, so {a:{b:1}, c:2} and {a:{b:1, c:2}} are different
+        hash.update(uint8_t(0xff));
+    }
+
+    static void packValue(const IEnum& en, XxHash64& hash, Option /*opt*/)
+    {
+        hash.update(int64_t(en.asInt()));
+    }
+
+    static void packValue(const IProtoMap& map, XxHash64& hash, Option opt)
+    {
+        hash.update(uint64_t(map.size()));
+        for (int i = 0; i < map.size(); ++i) {
+            visit(map.entryKey(i), hash, opt);
+            visit(map.entryValue(i), hash, opt);
+        }
+    }
+
+    static void packValue(const IVariant& var, XxHash64& hash, Option opt)
+    {
+        if (auto ptr = var.get()) {
+            hash.update(ptr->typeName());
+            visit(*ptr, hash, opt);
+        }
+    }
+
+    static void packValue(const ILazy& lazy, XxHash64& hash, Option opt)
+    {
+        visit(lazy.node(), hash, opt);
+    }
+};
+
+// =========================================================================================================================================
+
+uint64_t fingerprint(const Attribute& node)
+{
+    // Fingerprint is always of the whole node, whatever mask is active for serialization
+    FieldMask::Scope whole(nullptr);
+
+    XxHash64 hash;
+    Fingerprint::visit(node, hash, Option::No);
+    return hash.digest();
+}
+
+// =========================================================================================================================================
+
+} // namespace pack
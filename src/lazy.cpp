@@ -0,0 +1,99 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#include "pack/lazy.h"
+#include "pack/serialization.h"
+#include <stdexcept>
+
+// =========================================================================================================================================
+
+pack::ILazy::ILazy(Attribute* parent, const std::string& key)
+    : Attribute(NodeType::Lazy, parent, key)
+{
+}
+
+bool pack::ILazy::isRaw() const
+{
+    return m_format != Format::None;
+}
+
+pack::ILazy::Format pack::ILazy::format() const
+{
+    return m_format;
+}
+
+const std::string& pack::ILazy::raw() const
+{
+    return m_raw;
+}
+
+void pack::ILazy::setRaw(Format format, std::string&& content)
+{
+    holder().clear();
+    // Empty content (protobuf default message) means no value
+    m_format = content.empty() ? Format::None : format;
+    m_raw    = std::move(content);
+}
+
+const pack::INode& pack::ILazy::node() const
+{
+    decode();
+    return holder();
+}
+
+pack::INode& pack::ILazy::node()
+{
+    decode();
+    return holder();
+}
+
+void pack::ILazy::decode() const
+{
+    if (m_format == Format::None) {
+        return;
+    }
+
+    // Could be called in the middle of masked (de)serialization, raw content is always decoded whole
+    FieldMask::Scope whole(nullptr);
+
+    INode& node = const_cast<ILazy*>(this)->holder();
+    auto   ret  = [&]() -> fty::Expected<void> {
+        switch (m_format) {
+            case Format::Json:
+                return json::deserialize(m_raw, node);
+            case Format::Yaml:
+                return yaml::deserialize(m_raw, node);
+            case Format::Protobuf:
+#ifdef WITH_PROTOBUF
+                return protobuf::deserialize(m_raw, node);
+#else
+                return fty::unexpected("Protobuf is not supported");
+#endif
+            case Format::None:
+                break;
+        }
+        return {};
+    }();
+
+    if (!ret) {
+        throw std::runtime_error("Cannot decode " + key() + ": " + ret.error());
+    }
+
+    m_format = Format::None;
+    m_raw.clear();
+}
+
+// =========================================================================================================================================
@@ -17,6 +17,7 @@
 #include "pack/node.h"
 #include "pack/serialization.h"
 #include <algorithm>
+#include <mutex>
 
 // =========================================================================================================================================
 
@@ -32,6 +33,21 @@ pack::INode::INode(Attribute* parent, const std::string& key)
 
 pack::INode::~INode() = default;
 
+bool pack::INode::encodeProto(std::string& /*out*/) const
+{
+    return false;
+}
+
+bool pack::INode::decodeProto(std::string_view /*content*/)
+{
+    return false;
+}
+
+bool pack::INode::protoSize(size_t& /*size*/) const
+{
+    return false;
+}
+
 // =========================================================================================================================================
 
 std::string pack::Node::dump() const
@@ -131,3 +147,33 @@ void pack::Node::clear()
         it->clear();
     }
 }
+
+// =========================================================================================================================================
+
+static std::mutex& fileDescriptorsMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<pack::FileDescriptorFunc>& fileDescriptors()
+{
+    static std::vector<pack::FileDescriptorFunc> files;
+    return files;
+}
+
+bool pack::registerFileDescriptor(FileDescriptorFunc descriptor)
+{
+    std::lock_guard<std::mutex> lock(fileDescriptorsMutex());
+    auto&                       files = fileDescriptors();
+    if (std::find(files.begin(), files.end(), descriptor) == files.end()) {
+        files.push_back(descriptor);
+    }
+    return true;
+}
+
+std::vector<pack::FileDescriptorFunc> pack::registeredFileDescriptors()
+{
+    std::lock_guard<std::mutex> lock(fileDescriptorsMutex());
+    return fileDescriptors();
+}
@@ -0,0 +1,266 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#include "base64.h"
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PACK_BASE64_SSSE3
+#include <immintrin.h>
+#endif
+
+// Base64 codec. On x86 SSSE3 version is used for the bulk of the data when cpu supports it, tail and inputs with
+// whitespaces are done by the scalar version.
+// SIMD algorithms are from W. Mula, D. Lemire "Faster Base64 Encoding and Decoding using AVX2 Instructions".
+
+namespace pack::base64 {
+
+// =========================================================================================================================================
+
+static constexpr char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static constexpr unsigned char Invalid = 0xff;
+static constexpr unsigned char Space   = 0xfe;
+static constexpr unsigned char Pad     = 0xfd;
+
+struct DecodeTable
+{
+    unsigned char values[256];
+
+    constexpr DecodeTable()
+        : values{}
+    {
+        for (auto& it : values) {
+            it = Invalid;
+        }
+        for (unsigned char i = 0; i < 64; ++i) {
+            values[static_cast<unsigned char>(Alphabet[i])] = i;
+        }
+        values[static_cast<unsigned char>(' ')]  = Space;
+        values[static_cast<unsigned char>('\t')] = Space;
+        values[static_cast<unsigned char>('\r')] = Space;
+        values[static_cast<unsigned char>('\n')] = Space;
+        values[static_cast<unsigned char>('=')]  = Pad;
+    }
+};
+
+static constexpr DecodeTable Table;
+
+// =========================================================================================================================================
+
+static void encodeScalar(const unsigned char* data, size_t size, char* out)
+{
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t val = uint32_t(data[i]) << 16 | uint32_t(data[i + 1]) << 8 | uint32_t(data[i + 2]);
+        *out++       = Alphabet[(val >> 18) & 0x3f];
+        *out++       = Alphabet[(val >> 12) & 0x3f];
+        *out++       = Alphabet[(val >> 6) & 0x3f];
+        *out++       = Alphabet[val & 0x3f];
+    }
+
+    if (size - i == 1) {
+        uint32_t val = uint32_t(data[i]) << 16;
+        *out++       = Alphabet[(val >> 18) & 0x3f];
+        *out++       = Alphabet[(val >> 12) & 0x3f];
+        *out++       = '=';
+        *out++       = '=';
+    } else if (size - i == 2) {
+        uint32_t val = uint32_t(data[i]) << 16 | uint32_t(data[i + 1]) << 8;
+        *out++       = Alphabet[(val >> 18) & 0x3f];
+        *out++       = Alphabet[(val >> 12) & 0x3f];
+        *out++       = Alphabet[(val >> 6) & 0x3f];
+        *out++       = '=';
+    }
+}
+
+/// Decodes from `pos` to the end, returns size of the decoded data
+static size_t decodeScalar(std::string_view content, size_t pos, unsigned char* out)
+{
+    unsigned char* start   = out;
+    uint32_t       val     = 0;
+    int            count   = 0;
+    int            padding = 0;
+
+    for (; pos < content.size(); ++pos) {
+        unsigned char code = Table.values[static_cast<unsigned char>(content[pos])];
+        if (code == Space) {
+            continue;
+        }
+        if (code == Invalid) {
+            throw std::runtime_error("Wrong base64 content, unexpected symbol at " + std::to_string(pos));
+        }
+        if (code == Pad) {
+            if (count < 2) {
+                throw std::runtime_error("Wrong base64 content, unexpected padding at " + std::to_string(pos));
+            }
+            ++padding;
+            ++count;
+        } else {
+            if (padding) {
+                throw std::runtime_error("Wrong base64 content, data after padding at " + std::to_string(pos));
+            }
+            val = val << 6 | code;
+            ++count;
+        }
+
+        if (count == 4) {
+            if (padding == 0) {
+                *out++ = static_cast<unsigned char>(val >> 16);
+                *out++ = static_cast<unsigned char>(val >> 8);
+                *out++ = static_cast<unsigned char>(val);
+            } else if (padding == 1) {
+                val <<= 6;
+                *out++ = static_cast<unsigned char>(val >> 16);
+                *out++ = static_cast<unsigned char>(val >> 8);
+            } else {
+                val <<= 12;
+                *out++ = static_cast<unsigned char>(val >> 16);
+            }
+            val   = 0;
+            count = 0;
+        }
+    }
+
+    if (count != 0) {
+        throw std::runtime_error("Wrong base64 content, unexpected end");
+    }
+
+    return size_t(out - start);
+}
+
+// =========================================================================================================================================
+
+#ifdef PACK_BASE64_SSSE3
+
+static bool hasSsse3()
+{
+    static const bool has = __builtin_cpu_supports("ssse3");
+    return has;
+}
+
+/// Encodes 12 bytes chunks (16 bytes are read), returns count of the consumed bytes
+__attribute__((target("ssse3"))) static size_t encodeSsse3(const unsigned char* data, size_t size, char* out)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 12, out += 16) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+        // Split 3 bytes to 4 6-bit indexes
+        in               = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+        const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        const __m128i indexes = _mm_or_si128(t1, t3);
+
+        // Translate indexes to ascii
+        __m128i       result = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+        const __m128i less   = _mm_cmpgt_epi8(_mm_set1_epi8(26), indexes);
+        result               = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+        const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        result              = _mm_add_epi8(_mm_shuffle_epi8(shift, result), indexes);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), result);
+    }
+    return i;
+}
+
+/// Decodes 16 chars chunks to 12 bytes while content is valid, returns count of the consumed chars
+__attribute__((target("ssse3"))) static size_t decodeSsse3(std::string_view content, size_t end, unsigned char*& out)
+{
+    const __m128i shiftLut  = _mm_setr_epi8(0, 0, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i maskLut   = _mm_setr_epi8(char(0xa8), char(0xf8), char(0xf8), char(0xf8), char(0xf8), char(0xf8), char(0xf8),
+        char(0xf8), char(0xf8), char(0xf8), char(0xf0), char(0x54), char(0x50), char(0x50), char(0x50), char(0x54));
+    const __m128i bitposLut = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, char(0x80), 0, 0, 0, 0, 0, 0, 0, 0);
+
+    size_t i = 0;
+    for (; i + 16 <= end; i += 16, out += 12) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(content.data() + i));
+
+        const __m128i higher = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+        const __m128i lower  = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+
+        // Validation, anything unusual (padding, whitespaces, errors) is left for scalar version
+        const __m128i mask  = _mm_shuffle_epi8(maskLut, lower);
+        const __m128i bit   = _mm_shuffle_epi8(bitposLut, higher);
+        const __m128i wrong = _mm_cmpeq_epi8(_mm_and_si128(mask, bit), _mm_setzero_si128());
+        if (_mm_movemask_epi8(wrong)) {
+            break;
+        }
+
+        // Ascii to 6-bit values, '/' is the only one which has different shift in its row
+        const __m128i isSlash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+        const __m128i shift   = _mm_add_epi8(_mm_shuffle_epi8(shiftLut, higher), _mm_and_si128(isSlash, _mm_set1_epi8(-3)));
+        const __m128i values  = _mm_add_epi8(in, shift);
+
+        // Pack 4 6-bit values to 3 bytes
+        const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        __m128i       packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        packed = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        alignas(16) unsigned char buff[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(buff), packed);
+        std::memcpy(out, buff, 12);
+    }
+    return i;
+}
+
+#endif
+
+// =========================================================================================================================================
+
+std::string encode(const unsigned char* data, size_t size)
+{
+    std::string out((size + 2) / 3 * 4, '\0');
+    char*       dest = out.data();
+    size_t      done = 0;
+
+#ifdef PACK_BASE64_SSSE3
+    if (hasSsse3()) {
+        done = encodeSsse3(data, size, dest);
+        dest += done / 3 * 4;
+    }
+#endif
+
+    encodeScalar(data + done, size - done, dest);
+    return out;
+}
+
+std::vector<unsigned char> decode(std::string_view content)
+{
+    std::vector<unsigned char> out(content.size() / 4 * 3 + 3);
+    unsigned char*             dest = out.data();
+    size_t                     done = 0;
+
+#ifdef PACK_BASE64_SSSE3
+    // Last quantum could have a padding, always done by scalar version
+    if (hasSsse3() && content.size() > 4) {
+        done = decodeSsse3(content, content.size() - 4, dest);
+    }
+#endif
+
+    size_t size = size_t(dest - out.data()) + decodeScalar(content, done, dest);
+    out.resize(size);
+    return out;
+}
+
+// =========================================================================================================================================
+
+} // namespace pack::base64
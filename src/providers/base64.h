@@ -0,0 +1,30 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pack::base64 {
+
+/// Encodes data to base64 (RFC 4648, with padding)
+std::string encode(const unsigned char* data, size_t size);
+
+/// Decodes base64 content, whitespaces are skipped. Throws on malformed content
+std::vector<unsigned char> decode(std::string_view content);
+
+} // namespace pack::base64
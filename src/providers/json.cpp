@@ -1,9 +1,21 @@
 #include "pack/pack.h"
 #include "pack/serialization.h"
 #include "pack/visitor.h"
+#include "base64.h"
+#include "json.h"
 #include "utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
 #include <fty/flags.h>
+#include <iomanip>
+#include <istream>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <ostream>
+#include <typeindex>
+#include <unordered_map>
 
 namespace pack::json {
 
@@ -28,7 +40,9 @@ struct Convert
     static void decode(ValueList<ValType>& node, const nlohmann::ordered_json& json)
     {
         if constexpr (ValType == Type::UChar) {
-            if (!json.is_null()) {
+            if (json.is_string()) {
+                node.setValue(base64::decode(json.get_ref<const std::string&>()));
+            } else if (!json.is_null()) {
                 auto it = json.get<typename ValueList<ValType>::ListType>();
                 node.setValue(it);
             }
@@ -73,7 +87,11 @@ struct Convert
                     }
                 }
             } else if constexpr (ValType == Type::UChar) {
-                json = node.value();
+                if (fty::isSet(opt, Option::BinaryAsBase64)) {
+                    json = base64::encode(node.value().data(), node.value().size());
+                } else {
+                    json = node.value();
+                }
             } else {
                 for (const auto& it : node) {
                     if (fty::isSet(opt, Option::ValueAsString)) {
@@ -106,6 +124,21 @@ struct Convert
 
 // =========================================================================================================================================
 
+/// Raw content of the not touched lazy nodes, kept aside while encoding. Json tree has a placeholder at the place of
+/// every such node: binary value with the index of the content in the table, see write().
+using RawTable = std::vector<std::string_view>;
+
+/// Table of the running encode() of the thread, nullptr if raw content is not kept (pretty or canonical output)
+static thread_local RawTable* t_raws = nullptr;
+
+/// Float which is written as integer in canonical form: integral and exactly representable (-0.0 becomes 0)
+static bool isCanonicalInt(double val)
+{
+    return std::trunc(val) == val && std::fabs(val) < 9007199254740992.0;
+}
+
+// =========================================================================================================================================
+
 class JsonSerializer : public Serialize<JsonSerializer>
 {
 public:
@@ -121,12 +154,8 @@ public:
     {
         if (val.size()) {
             for (int i = 0; i < val.size(); ++i) {
-                const auto&            key  = val.keyByIndex(i);
-                const Attribute&       node = val.get(key);
-                nlohmann::ordered_json child;
-
-                visit(node, child, opt);
-                json[key] = child;
+                const auto& key = val.keyByIndex(i);
+                visit(val.get(key), json[key], opt);
             }
         } else if (fty::isSet(opt, Option::WithDefaults)) {
             json = nlohmann::json::object();
@@ -137,10 +166,7 @@ public:
     {
         if (val.size()) {
             for (int i = 0; i < val.size(); ++i) {
-                const Attribute&       node = val.get(i);
-                nlohmann::ordered_json child;
-                visit(node, child, opt);
-                json.push_back(child);
+                visit(val.get(i), json.emplace_back(), opt);
             }
         } else if (fty::isSet(opt, Option::WithDefaults)) {
             json = nlohmann::json::array();
@@ -150,12 +176,12 @@ public:
     static void packValue(const INode& node, nlohmann::ordered_json& json, Option opt)
     {
         json = nlohmann::json::object();
-        for (auto& it : node.fields()) {
-            if (it->hasValue() || fty::isSet(opt, Option::WithDefaults)) {
-                nlohmann::ordered_json& child = json[it->key()];
-                visit(*it, child, opt);
+        eachField(node, [&](const Attribute& it) {
+            if (it.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
+                nlohmann::ordered_json& child = json[it.key()];
+                visit(it, child, opt);
             }
-        }
+        });
     }
 
     static void packValue(const IEnum& en, nlohmann::ordered_json& json, Option /*opt*/)
@@ -166,13 +192,11 @@ public:
     static void packValue(const IProtoMap& map, nlohmann::ordered_json& json, Option opt)
     {
         for (int i = 0; i < map.size(); ++i) {
-            const INode& node = map.get(i);
-
-            nlohmann::ordered_json temp;
-            packValue(node, temp, opt);
-
-            std::string key = temp["key"];
-            json[key]       = temp["value"];
+            const Attribute&        value = map.entryValue(i);
+            nlohmann::ordered_json& child = json[keyToString(map.entryKey(i))];
+            if (value.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
+                visit(value, child, opt);
+            }
         }
     }
 
@@ -182,10 +206,430 @@ public:
             packValue(static_cast<const INode&>(*ptr), yaml, opt);
         }
     }
+
+    static void packValue(const ILazy& lazy, nlohmann::ordered_json& json, Option opt)
+    {
+        if (lazy.format() != ILazy::Format::Json) {
+            visit(lazy.node(), json, opt);
+        } else if (!t_raws) {
+            // Pretty and canonical forms need formatted content
+            json = nlohmann::ordered_json::parse(lazy.raw());
+        } else {
+            // Not touched, copied as is by write()
+            uint64_t index = t_raws->size();
+            t_raws->push_back(lazy.raw());
+
+            nlohmann::ordered_json::binary_t::container_type bytes(sizeof(index));
+            std::memcpy(bytes.data(), &index, sizeof(index));
+            json = nlohmann::ordered_json::binary(std::move(bytes));
+        }
+    }
 };
 
 // =========================================================================================================================================
 
+/// Sorts object keys (by bytes) and writes integral floats as integers, so equal nodes give byte identical output
+static void canonicalize(nlohmann::ordered_json& json)
+{
+    if (json.is_object()) {
+        auto& object = json.get_ref<nlohmann::ordered_json::object_t&>();
+
+        std::vector<std::pair<std::string, nlohmann::ordered_json>> items;
+        items.reserve(object.size());
+        for (auto& [key, value] : object) {
+            canonicalize(value);
+            items.emplace_back(key, std::move(value));
+        }
+        std::sort(items.begin(), items.end(), [](const auto& l, const auto& r) {
+            return l.first < r.first;
+        });
+
+        // Keys are unique already, so appended directly instead of ordered_map lookups
+        object.clear();
+        for (auto& [key, value] : items) {
+            object.emplace_back(std::move(key), std::move(value));
+        }
+    } else if (json.is_array()) {
+        for (auto& it : json) {
+            canonicalize(it);
+        }
+    } else if (json.is_number_float()) {
+        double val = json.get<double>();
+        if (isCanonicalInt(val)) {
+            json = int64_t(val);
+        }
+    }
+}
+
+/// Builds json of the node. Raw content of the not touched lazy nodes is put into the table for compact output.
+static void encode(const Attribute& node, nlohmann::ordered_json& json, RawTable& raws, Option opt)
+{
+    raws.clear();
+    bool keep = !fty::isSet(opt, Option::PrettyPrint) && !fty::isSet(opt, Option::Canonical);
+
+    RawTable* prev = t_raws;
+    t_raws         = keep ? &raws : nullptr;
+    try {
+        JsonSerializer::visit(node, json, opt);
+    } catch (...) {
+        t_raws = prev;
+        throw;
+    }
+    t_raws = prev;
+
+    if (fty::isSet(opt, Option::Canonical)) {
+        canonicalize(json);
+    }
+}
+
+/// Checks if json text could have spaces between the tokens
+static bool hasSpaces(std::string_view content)
+{
+    return content.find_first_of(" \t\n\r") != std::string_view::npos;
+}
+
+/// Appends json text without the spaces between the tokens
+static void appendMinified(std::string& out, std::string_view content)
+{
+    size_t start = 0;
+    bool   inStr = false;
+    for (size_t i = 0; i < content.size(); ++i) {
+        char ch = content[i];
+        if (inStr) {
+            if (ch == '\\') {
+                ++i;
+            } else if (ch == '"') {
+                inStr = false;
+            }
+        } else if (ch == '"') {
+            inStr = true;
+        } else if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r') {
+            out.append(content.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    out.append(content.substr(start));
+}
+
+/// Appends compact json with the placeholders (see encode()) replaced by the raw content
+static void writeRaw(const nlohmann::ordered_json& json, const RawTable& raws, std::string& out)
+{
+    switch (json.type()) {
+        case nlohmann::ordered_json::value_t::binary: {
+            uint64_t index = 0;
+            std::memcpy(&index, json.get_binary().data(), sizeof(index));
+            // Raw content set by the user could be formatted, compact output stays compact (one line for json lines)
+            appendMinified(out, raws[size_t(index)]);
+            break;
+        }
+        case nlohmann::ordered_json::value_t::object:
+            out += '{';
+            for (auto it = json.begin(); it != json.end(); ++it) {
+                if (it != json.begin()) {
+                    out += ',';
+                }
+                out += nlohmann::ordered_json(it.key()).dump();
+                out += ':';
+                writeRaw(it.value(), raws, out);
+            }
+            out += '}';
+            break;
+        case nlohmann::ordered_json::value_t::array:
+            out += '[';
+            for (auto it = json.begin(); it != json.end(); ++it) {
+                if (it != json.begin()) {
+                    out += ',';
+                }
+                writeRaw(*it, raws, out);
+            }
+            out += ']';
+            break;
+        default:
+            out += json.dump();
+            break;
+    }
+}
+
+/// Appends json to the output, same as dump() does
+static void write(const nlohmann::ordered_json& json, const RawTable& raws, std::string& out, Option opt)
+{
+    if (!raws.empty()) {
+        writeRaw(json, raws, out);
+    } else if (out.empty()) {
+        out = json.dump(fty::isSet(opt, Option::PrettyPrint) ? 4 : -1);
+    } else {
+        out += json.dump(fty::isSet(opt, Option::PrettyPrint) ? 4 : -1);
+    }
+}
+
+// =========================================================================================================================================
+
+/// Output size counter, indent is the current one for pretty print
+struct JsonSize
+{
+    size_t size   = 0;
+    size_t indent = 0;
+    bool   pretty = false;
+};
+
+/// Size of the string as written by nlohmann serializer (quotes included, ensure_ascii is off)
+static size_t stringSize(const std::string& str)
+{
+    size_t size = 2;
+    for (char ch : str) {
+        switch (ch) {
+            case '"':
+            case '\\':
+            case '\b':
+            case '\f':
+            case '\n':
+            case '\r':
+            case '\t':
+                size += 2;
+                break;
+            default:
+                size += static_cast<unsigned char>(ch) < 0x20 ? 6 : 1;
+        }
+    }
+    return size;
+}
+
+template <typename T>
+static size_t numberSize(T val, Option opt = Option::No)
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        if (!std::isfinite(val)) {
+            return 4;
+        }
+        if (fty::isSet(opt, Option::Canonical) && isCanonicalInt(double(val))) {
+            return numberSize(int64_t(val));
+        }
+        return nlohmann::ordered_json(double(val)).dump().size();
+    } else {
+        size_t   size = 1;
+        uint64_t abs  = uint64_t(val);
+        if constexpr (std::is_signed_v<T>) {
+            if (val < 0) {
+                abs = 0 - uint64_t(val);
+                ++size;
+            }
+        }
+        for (; abs >= 10; abs /= 10) {
+            ++size;
+        }
+        return size;
+    }
+}
+
+template <Type ValType>
+struct SizeOf
+{
+    using CppType = typename ResolveType<ValType>::type;
+
+    static size_t value(const CppType& val, Option opt)
+    {
+        if (fty::isSet(opt, Option::ValueAsString)) {
+            return stringSize(fty::convert<std::string>(val));
+        } else if constexpr (ValType == Type::String) {
+            return stringSize(val);
+        } else if constexpr (ValType == Type::Bool) {
+            return val ? 4 : 5;
+        } else {
+            return numberSize(val, opt);
+        }
+    }
+
+    static void encode(const Value<ValType>& node, JsonSize& out, Option opt)
+    {
+        out.size += value(node.value(), opt);
+    }
+
+    static void encode(const ValueList<ValType>& node, JsonSize& out, Option opt);
+    static void encode(const ValueMap<ValType>& node, JsonSize& out, Option opt);
+};
+
+/// Computes exact length of JsonSerializer output without building json, mirrors JsonSerializer and nlohmann dump
+class JsonSizer : public Serialize<JsonSizer>
+{
+public:
+    /// Counts value, which is written as null if serializer does not touch it
+    static void value(const Attribute& node, JsonSize& out, Option opt)
+    {
+        size_t before = out.size;
+        visit(node, out, opt);
+        if (out.size == before) {
+            out.size += 4;
+        }
+    }
+
+    /// Counts container, `func` is called with the member callback, which counts separators and indentation
+    template <typename Func>
+    static void container(JsonSize& out, Func&& func)
+    {
+        size_t count = 0;
+        out.indent += 4;
+        func([&]() {
+            if (count++) {
+                out.size += out.pretty ? 2 : 1;
+            }
+            if (out.pretty) {
+                out.size += out.indent;
+            }
+        });
+        out.indent -= 4;
+
+        if (count && out.pretty) {
+            out.size += 4 + out.indent;
+        } else {
+            out.size += 2;
+        }
+    }
+
+    /// Counts object member key
+    static void key(const std::string& key, JsonSize& out)
+    {
+        out.size += stringSize(key) + (out.pretty ? 2 : 1);
+    }
+
+    template <typename T>
+    static void packValue(const T& val, JsonSize& out, Option opt)
+    {
+        if (val.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
+            SizeOf<T::ThisType>::encode(val, out, opt);
+        }
+    }
+
+    static void packValue(const IObjectMap& val, JsonSize& out, Option opt)
+    {
+        if (val.size() || fty::isSet(opt, Option::WithDefaults)) {
+            container(out, [&](auto&& member) {
+                for (int i = 0; i < val.size(); ++i) {
+                    const auto& name = val.keyByIndex(i);
+                    member();
+                    key(name, out);
+                    value(val.get(name), out, opt);
+                }
+            });
+        }
+    }
+
+    static void packValue(const IObjectList& val, JsonSize& out, Option opt)
+    {
+        if (val.size() || fty::isSet(opt, Option::WithDefaults)) {
+            container(out, [&](auto&& member) {
+                for (int i = 0; i < val.size(); ++i) {
+                    member();
+                    value(val.get(i), out, opt);
+                }
+            });
+        }
+    }
+
+    static void packValue(const INode& node, JsonSize& out, Option opt)
+    {
+        container(out, [&](auto&& member) {
+            eachField(node, [&](const Attribute& it) {
+                if (it.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
+                    member();
+                    key(it.key(), out);
+                    value(it, out, opt);
+                }
+            });
+        });
+    }
+
+    static void packValue(const IEnum& en, JsonSize& out, Option /*opt*/)
+    {
+        out.size += stringSize(en.asString());
+    }
+
+    static void packValue(const IProtoMap& map, JsonSize& out, Option opt)
+    {
+        if (!map.size()) {
+            return;
+        }
+        container(out, [&](auto&& member) {
+            for (int i = 0; i < map.size(); ++i) {
+                const Attribute& entry = map.entryValue(i);
+                member();
+                key(keyToString(map.entryKey(i)), out);
+                if (entry.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
+                    value(entry, out, opt);
+                } else {
+                    out.size += 4;
+                }
+            }
+        });
+    }
+
+    static void packValue(const IVariant& var, JsonSize& out, Option opt)
+    {
+        if (auto ptr = var.get()) {
+            packValue(static_cast<const INode&>(*ptr), out, opt);
+        }
+    }
+
+    static void packValue(const ILazy& lazy, JsonSize& out, Option opt)
+    {
+        if (lazy.format() == ILazy::Format::Json && !out.pretty && !fty::isSet(opt, Option::Canonical)) {
+            if (hasSpaces(lazy.raw())) {
+                std::string content;
+                appendMinified(content, lazy.raw());
+                out.size += content.size();
+            } else {
+                out.size += lazy.raw().size();
+            }
+        } else if (lazy.format() == ILazy::Format::Json) {
+            auto json = nlohmann::ordered_json::parse(lazy.raw());
+            if (fty::isSet(opt, Option::Canonical)) {
+                canonicalize(json);
+            }
+            std::string content = json.dump(out.pretty ? 4 : -1);
+            // Nested content is indented by the current indent
+            out.size += content.size() + size_t(std::count(content.begin(), content.end(), '\n')) * out.indent;
+        } else {
+            visit(lazy.node(), out, opt);
+        }
+    }
+};
+
+template <Type ValType>
+void SizeOf<ValType>::encode(const ValueList<ValType>& node, JsonSize& out, Option opt)
+{
+    if constexpr (ValType == Type::UChar) {
+        if (node.size() && fty::isSet(opt, Option::BinaryAsBase64)) {
+            out.size += 2 + (node.value().size() + 2) / 3 * 4;
+            return;
+        }
+    }
+
+    JsonSizer::container(out, [&](auto&& member) {
+        for (const auto& it : node.value()) {
+            member();
+            if constexpr (ValType == Type::UChar) {
+                // Binary is always written as numbers
+                out.size += numberSize(it);
+            } else {
+                out.size += value(it, opt);
+            }
+        }
+    });
+}
+
+template <Type ValType>
+void SizeOf<ValType>::encode(const ValueMap<ValType>& node, JsonSize& out, Option opt)
+{
+    JsonSizer::container(out, [&](auto&& member) {
+        for (const auto& [key, val] : node) {
+            member();
+            JsonSizer::key(key, out);
+            out.size += value(val, opt);
+        }
+    });
+}
+
+// =========================================================================================================================================
+
 class JsonDeserializer : public Deserialize<JsonDeserializer>
 {
 public:
@@ -218,23 +662,19 @@ public:
 
     static void unpackValue(INode& node, const nlohmann::ordered_json& json)
     {
-        for (auto& it : node.fields()) {
-            if (json.contains(it->key())) {
-                visit(*it, json[it->key()]);
+        eachField(node, [&](Attribute& it) {
+            if (json.contains(it.key())) {
+                visit(it, json[it.key()]);
             }
-        }
+        });
     }
 
     static void unpackValue(IProtoMap& map, const nlohmann::ordered_json& json)
     {
         for (const auto& [key, value] : json.items()) {
-            INode& obj = map.create();
-
-            nlohmann::ordered_json temp;
-            temp["key"]   = key;
-            temp["value"] = value;
-
-            visit(obj, temp);
+            auto [fkey, fvalue] = map.createEntry();
+            keyFromString(fkey, key);
+            visit(fvalue, value);
         }
     }
 
@@ -250,31 +690,689 @@ public:
             }
         }
     }
+
+    static void unpackValue(ILazy& lazy, const nlohmann::ordered_json& json)
+    {
+        if (json.is_null()) {
+            lazy.clear();
+        } else {
+            lazy.setRaw(ILazy::Format::Json, json.dump());
+        }
+    }
 };
 
+// =========================================================================================================================================
+
+/// Json parser callback which drops members not selected by the field mask while parsing, so they are never built.
+/// Types of the containers are taken from the target node, content which type is not known (elements of the object
+/// lists and maps) is filtered by one level only, the rest is done by the deserializer.
+class MaskFilter
+{
+public:
+    MaskFilter(const Attribute& node, const FieldMask& mask)
+        : m_next(frame(&node, &mask))
+    {
+    }
+
+    bool operator()(int depth, nlohmann::ordered_json::parse_event_t event, nlohmann::ordered_json& parsed)
+    {
+        using Event = nlohmann::ordered_json::parse_event_t;
+
+        switch (event) {
+            case Event::object_start:
+            case Event::array_start:
+                m_stack.resize(size_t(depth));
+                if (!m_stack.empty()) {
+                    const Frame& parent = m_stack.back();
+                    if (parent.kind == Kind::List || parent.kind == Kind::Map) {
+                        m_next = {Kind::Node, nullptr, parent.mask};
+                    } else if (parent.kind == Kind::Whole) {
+                        m_next = {};
+                    }
+                }
+                m_stack.push_back(m_next);
+                m_next = {};
+                return true;
+            case Event::key: {
+                const Frame& current = m_stack[size_t(depth - 1)];
+                if (current.kind != Kind::Node) {
+                    return true;
+                }
+
+                const std::string& key  = parsed.get_ref<const std::string&>();
+                const FieldMask*   mask = current.mask->find(key);
+                if (!mask) {
+                    m_next = {};
+                    return false;
+                }
+
+                const Attribute* schema = nullptr;
+                if (current.schema) {
+                    for (const auto* it : static_cast<const INode*>(current.schema)->fields()) {
+                        if (it->key() == key) {
+                            schema = it;
+                            break;
+                        }
+                    }
+                }
+                m_next = frame(schema, mask);
+                return true;
+            }
+            default:
+                return true;
+        }
+    }
+
+private:
+    enum class Kind
+    {
+        Whole,
+        Node,
+        List,
+        Map
+    };
+
+    struct Frame
+    {
+        Kind             kind   = Kind::Whole;
+        const Attribute* schema = nullptr;
+        const FieldMask* mask   = nullptr;
+    };
+
+    static Frame frame(const Attribute* schema, const FieldMask* mask)
+    {
+        if (!schema || mask->empty()) {
+            return {};
+        }
+
+        switch (schema->type()) {
+            case Attribute::NodeType::Node:
+                return {Kind::Node, schema, mask};
+            case Attribute::NodeType::Variant:
+                return {Kind::Node, nullptr, mask};
+            case Attribute::NodeType::List:
+                if (dynamic_cast<const IObjectList*>(schema)) {
+                    return {Kind::List, nullptr, mask};
+                }
+                return {};
+            case Attribute::NodeType::Map:
+                if (dynamic_cast<const IObjectMap*>(schema)) {
+                    return {Kind::Map, nullptr, mask};
+                }
+                return {};
+            default:
+                return {};
+        }
+    }
+
+private:
+    std::vector<Frame> m_stack;
+    Frame              m_next;
+};
 
 // =========================================================================================================================================
 
+// Large top level lists are (de)serialized by chunks in parallel, see serializeList() and deserializeList()
+
+/// Minimal count of the list elements to go parallel
+static constexpr size_t ParallelListSize = 4096;
+/// Elements serialized by one task
+static constexpr size_t ParallelChunkSize = 1024;
+/// Minimal content size to look for the list elements
+static constexpr size_t ParallelContentSize = 64 * 1024;
+
+/// Finds [begin, end) of the elements of top level json array, nullopt if content is not an array
+static std::optional<std::vector<std::pair<size_t, size_t>>> splitArray(std::string_view content)
+{
+    auto isSpace = [](char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+    };
+
+    size_t pos = 0;
+    while (pos < content.size() && isSpace(content[pos])) {
+        ++pos;
+    }
+    if (pos == content.size() || content[pos] != '[') {
+        return std::nullopt;
+    }
+
+    std::vector<std::pair<size_t, size_t>> elements;
+    size_t                                 start  = pos + 1;
+    int                                    depth  = 1;
+    bool                                   inStr  = false;
+    bool                                   closed = false;
+
+    auto addElement = [&](size_t end) {
+        size_t begin = start;
+        while (begin < end && isSpace(content[begin])) {
+            ++begin;
+        }
+        while (end > begin && isSpace(content[end - 1])) {
+            --end;
+        }
+        if (begin == end) {
+            return false;
+        }
+        elements.emplace_back(begin, end);
+        return true;
+    };
+
+    for (++pos; pos < content.size() && !closed; ++pos) {
+        char ch = content[pos];
+        if (inStr) {
+            if (ch == '\\') {
+                ++pos;
+            } else if (ch == '"') {
+                inStr = false;
+            }
+            continue;
+        }
+
+        switch (ch) {
+            case '"':
+                inStr = true;
+                break;
+            case '[':
+            case '{':
+                ++depth;
+                break;
+            case ']':
+            case '}':
+                if (--depth == 0) {
+                    // Empty array is fine, empty element is not
+                    if (!addElement(pos) && !elements.empty()) {
+                        return std::nullopt;
+                    }
+                    closed = true;
+                }
+                break;
+            case ',':
+                if (depth == 1) {
+                    if (!addElement(pos)) {
+                        return std::nullopt;
+                    }
+                    start = pos + 1;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    while (pos < content.size() && isSpace(content[pos])) {
+        ++pos;
+    }
+    if (!closed || depth != 0 || pos != content.size()) {
+        return std::nullopt;
+    }
+    return elements;
+}
+
+/// Checks if the node has lazy fields, directly or in the sub nodes, cached by type
+static bool hasLazy(const INode& node)
+{
+    thread_local std::unordered_map<std::type_index, bool> cache;
+    if (auto it = cache.find(typeid(node)); it != cache.end()) {
+        return it->second;
+    }
+
+    bool found = false;
+    for (const auto* it : node.fields()) {
+        if (it->type() == Attribute::NodeType::Lazy ||
+            (it->type() == Attribute::NodeType::Node && hasLazy(static_cast<const INode&>(*it)))) {
+            found = true;
+            break;
+        }
+    }
+    cache.emplace(typeid(node), found);
+    return found;
+}
+
+/// Cuts the values of the lazy fields out of json content, so the parser never builds them. Lazy fields of the node and
+/// of its sub nodes are found, lists, maps and variants are not looked into.
+class JsonSlicer
+{
+public:
+    struct Slice
+    {
+        ILazy*           lazy;
+        std::string_view content;
+    };
+
+    JsonSlicer(std::string_view content)
+        : m_content(content)
+    {
+    }
+
+    /// Returns content with null instead of the lazy values, throws if content is broken
+    std::string strip(INode& node)
+    {
+        size_t pos = space(0);
+        if (at(pos) == '{') {
+            object(pos, node);
+        }
+        m_out.append(m_content.substr(m_copied));
+        return std::move(m_out);
+    }
+
+    /// Values of the lazy fields found by strip(), as is
+    const std::vector<Slice>& slices() const
+    {
+        return m_slices;
+    }
+
+private:
+    char at(size_t pos) const
+    {
+        return pos < m_content.size() ? m_content[pos] : '\0';
+    }
+
+    size_t space(size_t pos) const
+    {
+        while (at(pos) == ' ' || at(pos) == '\t' || at(pos) == '\n' || at(pos) == '\r') {
+            ++pos;
+        }
+        return pos;
+    }
+
+    /// Position after the string at pos
+    size_t string(size_t pos) const
+    {
+        for (++pos; pos < m_content.size(); ++pos) {
+            if (m_content[pos] == '\\') {
+                ++pos;
+            } else if (m_content[pos] == '"') {
+                return pos + 1;
+            }
+        }
+        throw std::runtime_error("Broken json content");
+    }
+
+    /// Position after the value at pos
+    size_t value(size_t pos) const
+    {
+        if (at(pos) == '"') {
+            return string(pos);
+        }
+        if (at(pos) == '{' || at(pos) == '[') {
+            int depth = 0;
+            do {
+                switch (at(pos)) {
+                    case '"':
+                        pos = string(pos);
+                        continue;
+                    case '{':
+                    case '[':
+                        ++depth;
+                        break;
+                    case '}':
+                    case ']':
+                        --depth;
+                        break;
+                    case '\0':
+                        throw std::runtime_error("Broken json content");
+                    default:
+                        break;
+                }
+                ++pos;
+            } while (depth);
+            return pos;
+        }
+
+        size_t begin = pos;
+        while (pos < m_content.size() && std::string_view(",}] \t\r\n").find(m_content[pos]) == std::string_view::npos) {
+            ++pos;
+        }
+        if (pos == begin) {
+            throw std::runtime_error("Broken json content");
+        }
+        return pos;
+    }
+
+    /// Position after the object at pos
+    size_t object(size_t pos, INode& node)
+    {
+        pos = space(pos + 1);
+        if (at(pos) == '}') {
+            return pos + 1;
+        }
+
+        const auto fields = node.fields();
+        while (true) {
+            if (at(pos) != '"') {
+                throw std::runtime_error("Broken json content");
+            }
+            size_t           keyEnd = string(pos);
+            std::string_view key    = m_content.substr(pos + 1, keyEnd - pos - 2);
+
+            pos = space(keyEnd);
+            if (at(pos) != ':') {
+                throw std::runtime_error("Broken json content");
+            }
+            size_t begin = space(pos + 1);
+
+            auto found = std::find_if(fields.begin(), fields.end(), [&](const Attribute* attr) {
+                return std::string_view(attr->key()) == key;
+            });
+            Attribute* field = found != fields.end() ? *found : nullptr;
+
+            size_t end = 0;
+            if (field && field->type() == Attribute::NodeType::Lazy) {
+                end = value(begin);
+                m_out.append(m_content.substr(m_copied, begin - m_copied));
+                m_out += "null";
+                m_copied = end;
+
+                // Null clears the lazy node, done by the parser
+                if (auto raw = m_content.substr(begin, end - begin); raw != "null") {
+                    m_slices.push_back({static_cast<ILazy*>(field), raw});
+                }
+            } else if (
+                field && field->type() == Attribute::NodeType::Node && at(begin) == '{' &&
+                hasLazy(static_cast<const INode&>(*field))) {
+                end = object(begin, static_cast<INode&>(*field));
+            } else {
+                end = value(begin);
+            }
+
+            pos = space(end);
+            if (at(pos) == '}') {
+                return pos + 1;
+            }
+            if (at(pos) != ',') {
+                throw std::runtime_error("Broken json content");
+            }
+            pos = space(pos + 1);
+        }
+    }
+
+private:
+    std::string_view   m_content;
+    std::string        m_out;
+    size_t             m_copied = 0;
+    std::vector<Slice> m_slices;
+};
+
+/// Decodes json document by the backend, values of the lazy fields are not parsed, but kept as compact text (see JsonSlicer)
+static fty::Expected<void> decodeSliced(std::string_view content, Attribute& node)
+{
+    auto inode = dynamic_cast<INode*>(&node);
+    if (!inode || !hasLazy(*inode)) {
+        return decode(content, node);
+    }
+
+    try {
+        JsonSlicer slicer(content);
+        if (auto ret = decode(slicer.strip(*inode), node); !ret) {
+            return ret;
+        }
+        for (const auto& it : slicer.slices()) {
+            // Spaces of the input are not kept, so compact output stays compact
+            std::string raw;
+            raw.reserve(it.content.size());
+            appendMinified(raw, it.content);
+            it.lazy->setRaw(ILazy::Format::Json, std::move(raw));
+        }
+        return {};
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+/// Decodes elements found by splitArray() in parallel into the new elements of the list
+static fty::Expected<void> deserializeList(
+    std::string_view content, const std::vector<std::pair<size_t, size_t>>& elements, IObjectList& list)
+{
+    int first = list.size();
+    list.reserve(first + int(elements.size()));
+    for (size_t i = 0; i < elements.size(); ++i) {
+        list.create();
+    }
+
+    return parallelFor(elements.size(), 0, [&](size_t i) {
+        const auto& [begin, end] = elements[i];
+        return decodeSliced(content.substr(begin, end - begin), list.get(first + int(i)));
+    });
+}
+
+/// Serializes list by chunks in parallel, every chunk has its own json tree and output, outputs are joined in order
+static void serializeList(const IObjectList& list, std::string& out, Option opt)
+{
+    const bool   pretty = fty::isSet(opt, Option::PrettyPrint);
+    const size_t count  = size_t(list.size());
+
+    std::vector<std::string> chunks((count + ParallelChunkSize - 1) / ParallelChunkSize);
+
+    auto ret = parallelFor(chunks.size(), 0, [&](size_t chunk) -> fty::Expected<void> {
+        nlohmann::ordered_json json;
+        RawTable               raws;
+
+        size_t end = std::min(count, (chunk + 1) * ParallelChunkSize);
+        for (size_t i = chunk * ParallelChunkSize; i < end; ++i) {
+            json = nullptr;
+            encode(list.get(int(i)), json, raws, opt);
+            if (i) {
+                chunks[chunk] += pretty ? ",\n" : ",";
+            }
+            if (pretty) {
+                // Same as nlohmann does for array elements: new lines are structural only (escaped in strings)
+                std::string element = json.dump(4);
+                chunks[chunk].append(4, ' ');
+                size_t start = 0;
+                for (size_t pos = element.find('\n'); pos != std::string::npos; pos = element.find('\n', start)) {
+                    chunks[chunk].append(element, start, pos + 1 - start);
+                    chunks[chunk].append(4, ' ');
+                    start = pos + 1;
+                }
+                chunks[chunk].append(element, start);
+            } else {
+                write(json, raws, chunks[chunk], opt);
+            }
+        }
+        return {};
+    });
+    if (!ret) {
+        throw std::runtime_error(ret.error());
+    }
+
+    size_t size = 4;
+    for (const auto& it : chunks) {
+        size += it.size();
+    }
+    out.reserve(out.size() + size);
+
+    out += pretty ? "[\n" : "[";
+    for (const auto& it : chunks) {
+        out += it;
+    }
+    out += pretty ? "\n]" : "]";
+}
+
 fty::Expected<std::string> serialize(const Attribute& node, Option opt)
+{
+    std::string out;
+    if (auto ret = serialize(node, out, opt); !ret) {
+        return fty::unexpected(ret.error());
+    }
+    return out;
+}
+
+fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt)
+{
+    FieldMask::Scope scope(&mask);
+    return serialize(node, opt);
+}
+
+fty::Expected<void> serialize(const Attribute& node, std::string& out, Option opt)
 {
     try {
+        if (auto list = dynamic_cast<const IObjectList*>(&node); list && size_t(list->size()) >= ParallelListSize) {
+            serializeList(*list, out, opt);
+            return {};
+        }
+
         nlohmann::ordered_json json;
-        JsonSerializer::visit(node, json, opt);
-        if(fty::isSet(opt, Option::PrettyPrint)) {
-            return json.dump(4);
+        RawTable               raws;
+        encode(node, json, raws, opt);
+        write(json, raws, out, opt);
+        return {};
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+fty::Expected<size_t> serializedSize(const Attribute& node, Option opt)
+{
+    try {
+        JsonSize out;
+        out.pretty = fty::isSet(opt, Option::PrettyPrint);
+        JsonSizer::value(node, out, opt);
+        return out.size;
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+/// Serializes elements into the batch, json tree and serializer are shared by all the elements
+template <typename Get>
+static fty::Expected<void> serializeBatch(size_t count, Get&& get, Batch& out, Option opt)
+{
+    size_t bufferSize = out.buffer.size();
+    size_t slicesSize = out.slices.size();
+    size_t i          = 0;
+    try {
+        nlohmann::ordered_json json;
+        RawTable               raws;
+        out.slices.reserve(slicesSize + count);
+        for (; i < count; ++i) {
+            const Attribute* node = get(i);
+            if (!node) {
+                throw std::runtime_error("Node is null");
+            }
+
+            json = nullptr;
+            encode(*node, json, raws, opt);
+
+            size_t offset = out.buffer.size();
+            write(json, raws, out.buffer, opt);
+            out.slices.push_back({offset, out.buffer.size() - offset});
+        }
+        return {};
+    } catch (const std::exception& e) {
+        out.buffer.resize(bufferSize);
+        out.slices.resize(slicesSize);
+        return fty::unexpected("Element {}: {}", i, e.what());
+    }
+}
+
+fty::Expected<void> serialize(const std::vector<const Attribute*>& nodes, Batch& out, Option opt)
+{
+    return serializeBatch(
+        nodes.size(),
+        [&](size_t i) {
+            return nodes[i];
+        },
+        out, opt);
+}
+
+fty::Expected<void> serialize(const IObjectList& list, Batch& out, Option opt)
+{
+    return serializeBatch(
+        size_t(list.size()),
+        [&](size_t i) {
+            return &list.get(int(i));
+        },
+        out, opt);
+}
+
+fty::Expected<void> serialize(const Attribute& node, std::ostream& out, Option opt)
+{
+    try {
+        if (auto list = dynamic_cast<const IObjectList*>(&node); list && size_t(list->size()) >= ParallelListSize) {
+            std::string content;
+            serializeList(*list, content, opt);
+            out.write(content.data(), std::streamsize(content.size()));
+            if (!out) {
+                return fty::unexpected("Cannot write to the stream");
+            }
+            return {};
+        }
+
+        nlohmann::ordered_json json;
+        RawTable               raws;
+        encode(node, json, raws, opt);
+        if (!raws.empty()) {
+            std::string content;
+            writeRaw(json, raws, content);
+            out.write(content.data(), std::streamsize(content.size()));
+        } else if (fty::isSet(opt, Option::PrettyPrint)) {
+            out << std::setw(4) << json;
         } else {
-            return json.dump();
+            out << json;
         }
-        
+        if (!out) {
+            return fty::unexpected("Cannot write to the stream");
+        }
+        return {};
     } catch (const std::exception& e) {
         return fty::unexpected(e.what());
     }
 }
 
+fty::Expected<void> decodeNlohmann(std::string_view content, Attribute& node)
+{
+    try {
+        nlohmann::ordered_json json = nlohmann::ordered_json::parse(content.begin(), content.end());
+        JsonDeserializer::visit(node, json);
+        return {};
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+#ifndef WITH_SIMDJSON
+// Otherwise simdjson backend is used, see simdjson.cpp
+fty::Expected<void> decode(std::string_view content, Attribute& node)
+{
+    return decodeNlohmann(content, node);
+}
+#endif
+
+/// Large top level lists are decoded in parallel, the rest by the backend
+static fty::Expected<void> deserializeContent(std::string_view content, Attribute& node)
+{
+    if (auto list = dynamic_cast<IObjectList*>(&node); list && content.size() >= ParallelContentSize) {
+        if (auto elements = splitArray(content); elements && elements->size() >= ParallelListSize) {
+            return deserializeList(content, *elements, *list);
+        }
+    }
+    return decodeSliced(content, node);
+}
+
 fty::Expected<void> deserialize(const std::string& content, Attribute& node)
+{
+    return deserializeContent(content, node);
+}
+
+fty::Expected<void> deserializeMany(
+    const std::vector<std::string_view>& payloads, const std::vector<Attribute*>& nodes, size_t threads)
+{
+    if (payloads.size() != nodes.size()) {
+        return fty::unexpected("Count of payloads ({}) and nodes ({}) differs", payloads.size(), nodes.size());
+    }
+    return parallelFor(payloads.size(), threads, [&](size_t i) -> fty::Expected<void> {
+        if (!nodes[i]) {
+            return fty::unexpected("Node is null");
+        }
+        return deserializeContent(payloads[i], *nodes[i]);
+    });
+}
+
+fty::Expected<void> deserialize(const std::string& content, Attribute& node, const FieldMask& mask)
 {
     try {
-        nlohmann::ordered_json json = nlohmann::ordered_json::parse(content);
+        FieldMask::Scope       scope(&mask);
+        nlohmann::ordered_json json = nlohmann::ordered_json::parse(content, MaskFilter(node, mask));
         JsonDeserializer::visit(node, json);
         return {};
     } catch (const std::exception& e) {
@@ -293,14 +1391,92 @@ fty::Expected<void> deserializeFile(const std::string& fileName, Attribute& node
 
 fty::Expected<void> serializeFile(const std::string& fileName, const Attribute& node, Option opt)
 {
-    if (auto ret = serialize(node, opt)) {
-        if (auto res = write(fileName, *ret); !res) {
-            return fty::unexpected(res.error());
+    std::ofstream st(fileName);
+    if (!st.is_open()) {
+        return fty::unexpected("Cannot write file {}", fileName);
+    }
+    return serialize(node, st, opt);
+}
+
+// =========================================================================================================================================
+
+fty::Expected<void> serializeLines(std::ostream& out, const IObjectList& list, Option opt)
+{
+    try {
+        nlohmann::ordered_json json;
+        RawTable               raws;
+        std::string            line;
+        for (int i = 0; i < list.size(); ++i) {
+            json = nullptr;
+            line.clear();
+            encode(list.get(i), json, raws, opt);
+            write(json, raws, line, Option::No);
+            line += '\n';
+            out.write(line.data(), std::streamsize(line.size()));
+            if (!out) {
+                return fty::unexpected("Cannot write element {}", i);
+            }
         }
         return {};
-    } else {
-        return fty::unexpected(ret.error());
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+fty::Expected<void> deserializeLines(std::istream& in, Attribute& item, const std::function<void()>& func)
+{
+    std::string line;
+    size_t      lineNum = 0;
+    while (std::getline(in, line)) {
+        ++lineNum;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        try {
+            item.clear();
+            if (auto ret = decodeSliced(line, item); !ret) {
+                throw std::runtime_error(ret.error());
+            }
+        } catch (const std::exception& e) {
+            return fty::unexpected("Line {}: {}", lineNum, e.what());
+        }
+        func();
+    }
+    return {};
+}
+
+fty::Expected<void> deserializeLines(
+    std::istream& in, IObjectList& batch, int batchSize, const std::function<void(IObjectList&)>& func)
+{
+    if (batchSize <= 0) {
+        return fty::unexpected("Wrong batch size {}", batchSize);
+    }
+
+    std::string line;
+    size_t      lineNum = 0;
+    batch.clear();
+    while (std::getline(in, line)) {
+        ++lineNum;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        try {
+            if (auto ret = decodeSliced(line, batch.create()); !ret) {
+                throw std::runtime_error(ret.error());
+            }
+        } catch (const std::exception& e) {
+            return fty::unexpected("Line {}: {}", lineNum, e.what());
+        }
+        if (batch.size() >= batchSize) {
+            func(batch);
+            batch.clear();
+        }
+    }
+    if (batch.size()) {
+        func(batch);
+        batch.clear();
     }
+    return {};
 }
 
 } // namespace pack::json
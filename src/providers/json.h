@@ -0,0 +1,33 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#pragma once
+#include <fty/expected.h>
+#include <string_view>
+
+namespace pack {
+class Attribute;
+}
+
+namespace pack::json {
+
+/// Decodes one json document into the node, done by nlohmann (json.cpp) or simdjson (simdjson.cpp) backend
+fty::Expected<void> decode(std::string_view content, Attribute& node);
+
+/// Decodes one json document into the node by nlohmann parser, whatever backend is used by `decode`
+fty::Expected<void> decodeNlohmann(std::string_view content, Attribute& node);
+
+} // namespace pack::json
@@ -15,355 +15,1262 @@
 */
 
 #include "pack/visitor.h"
+#include "pack/wire.h"
+#include "utils.h"
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
 #include <google/protobuf/descriptor_database.h>
-#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+#include <unistd.h>
 
 namespace pack {
 
 namespace pb = google::protobuf;
 
-template <Type ValType>
-struct Convert
+/// Field descriptors of the node type by the field index in INode::fields() (nullptr if message has no such field) and
+/// back, field indexes by the field numbers. Bound by the field keys once per node type and message descriptor, every
+/// thread keeps its own bindings. Variant is bound to the oneof of the same name: to its first field, and all the
+/// oneof field numbers lead to the variant.
+class Binding
 {
-    using CppType       = typename ResolveType<ValType>::type;
-    using WalkType      = std::tuple<pb::Message*, const pb::FieldDescriptor*>;
-    using ConstWalkType = std::tuple<const pb::Message*, const pb::FieldDescriptor*>;
+public:
+    static const Binding& of(const INode& node, const pb::Descriptor* descr)
+    {
+        thread_local std::unordered_map<Key, Binding, KeyHash> cache;
+
+        Key key{typeid(node), descr};
+        if (auto it = cache.find(key); it != cache.end()) {
+            return it->second;
+        }
+
+        Binding bound;
+        for (const auto* it : node.fields()) {
+            const pb::FieldDescriptor* fdesc = descr->FindFieldByName(it->key());
+            if (fdesc) {
+                bound.m_indexes.emplace(fdesc->number(), bound.m_fields.size());
+            } else if (it->type() == Attribute::NodeType::Variant) {
+                const pb::OneofDescriptor* oneof = descr->FindOneofByName(it->key());
+                for (int i = 0; oneof && i < oneof->field_count(); ++i) {
+                    bound.m_indexes.emplace(oneof->field(i)->number(), bound.m_fields.size());
+                    fdesc = fdesc ? fdesc : oneof->field(i);
+                }
+            }
+            bound.m_fields.push_back(fdesc);
+        }
+        return cache.emplace(key, std::move(bound)).first->second;
+    }
 
-    static void decode(Value<ValType>& node, const ConstWalkType& proto)
+    const pb::FieldDescriptor* field(size_t index) const
     {
-        auto refl = std::get<0>(proto)->GetReflection();
+        return m_fields[index];
+    }
 
-        if constexpr (ValType == Type::Bool) {
-            node = refl->GetBool(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::Double) {
-            node = refl->GetDouble(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::Float) {
-            node = refl->GetFloat(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::Int32) {
-            node = refl->GetInt32(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::Int64) {
-            node = refl->GetInt64(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::String) {
-            node = refl->GetString(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::UInt32) {
-            node = refl->GetUInt32(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::UInt64) {
-            node = refl->GetUInt64(*std::get<0>(proto), std::get<1>(proto));
-        } else if constexpr (ValType == Type::UChar) {
-            node = static_cast<unsigned char>(refl->GetUInt32(*std::get<0>(proto), std::get<1>(proto)));
+    /// Finds index of the field by its number, returns false if node has no such field
+    bool find(int number, size_t& index) const
+    {
+        auto it = m_indexes.find(number);
+        if (it == m_indexes.end()) {
+            return false;
         }
+        index = it->second;
+        return true;
     }
 
-    static void decode(ValueList<ValType>& node, const ConstWalkType& proto)
+private:
+    using Key = std::pair<std::type_index, const pb::Descriptor*>;
+
+    struct KeyHash
     {
-        auto refl = std::get<0>(proto)->GetReflection();
+        size_t operator()(const Key& key) const
+        {
+            return key.first.hash_code() ^ std::hash<const void*>()(key.second);
+        }
+    };
 
-        if constexpr (ValType == Type::UChar) {
-            std::string str = refl->GetString(*std::get<0>(proto), std::get<1>(proto));
-            node.setValue(typename ValueList<ValType>::ListType(str.begin(), str.end()));
-        } else {
-            for (int i = 0; i < refl->FieldSize(*std::get<0>(proto), std::get<1>(proto)); ++i) {
-                if constexpr (ValType == Type::Bool) {
-                    node.append(refl->GetRepeatedBool(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::Double) {
-                    node.append(refl->GetRepeatedDouble(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::Float) {
-                    node.append(refl->GetRepeatedFloat(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::Int32) {
-                    node.append(refl->GetRepeatedInt32(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::Int64) {
-                    node.append(refl->GetRepeatedInt64(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::String) {
-                    node.append(refl->GetRepeatedString(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::UInt32) {
-                    node.append(refl->GetRepeatedUInt32(*std::get<0>(proto), std::get<1>(proto), i));
-                } else if constexpr (ValType == Type::UInt64) {
-                    node.append(refl->GetRepeatedUInt64(*std::get<0>(proto), std::get<1>(proto), i));
-                }
-            }
+    std::vector<const pb::FieldDescriptor*> m_fields;
+    std::unordered_map<int, size_t>         m_indexes;
+};
+
+// =========================================================================================================================================
+
+/// Protobuf wire format of the fields described at runtime
+namespace wire {
+
+    /// Calls `func` with the field type as compile time constant
+    template <typename Func>
+    static void withType(const pb::FieldDescriptor* fdesc, Func&& func)
+    {
+        switch (fdesc->type()) {
+            case pb::FieldDescriptor::TYPE_DOUBLE:
+                return func(std::integral_constant<ProtoType, ProtoType::Double>());
+            case pb::FieldDescriptor::TYPE_FLOAT:
+                return func(std::integral_constant<ProtoType, ProtoType::Float>());
+            case pb::FieldDescriptor::TYPE_INT64:
+                return func(std::integral_constant<ProtoType, ProtoType::Int64>());
+            case pb::FieldDescriptor::TYPE_UINT64:
+                return func(std::integral_constant<ProtoType, ProtoType::UInt64>());
+            case pb::FieldDescriptor::TYPE_INT32:
+                return func(std::integral_constant<ProtoType, ProtoType::Int32>());
+            case pb::FieldDescriptor::TYPE_FIXED64:
+                return func(std::integral_constant<ProtoType, ProtoType::Fixed64>());
+            case pb::FieldDescriptor::TYPE_FIXED32:
+                return func(std::integral_constant<ProtoType, ProtoType::Fixed32>());
+            case pb::FieldDescriptor::TYPE_BOOL:
+                return func(std::integral_constant<ProtoType, ProtoType::Bool>());
+            case pb::FieldDescriptor::TYPE_STRING:
+                return func(std::integral_constant<ProtoType, ProtoType::String>());
+            case pb::FieldDescriptor::TYPE_MESSAGE:
+                return func(std::integral_constant<ProtoType, ProtoType::Message>());
+            case pb::FieldDescriptor::TYPE_BYTES:
+                return func(std::integral_constant<ProtoType, ProtoType::Bytes>());
+            case pb::FieldDescriptor::TYPE_UINT32:
+                return func(std::integral_constant<ProtoType, ProtoType::UInt32>());
+            case pb::FieldDescriptor::TYPE_ENUM:
+                return func(std::integral_constant<ProtoType, ProtoType::Enum>());
+            case pb::FieldDescriptor::TYPE_SFIXED32:
+                return func(std::integral_constant<ProtoType, ProtoType::SFixed32>());
+            case pb::FieldDescriptor::TYPE_SFIXED64:
+                return func(std::integral_constant<ProtoType, ProtoType::SFixed64>());
+            case pb::FieldDescriptor::TYPE_SINT32:
+                return func(std::integral_constant<ProtoType, ProtoType::SInt32>());
+            case pb::FieldDescriptor::TYPE_SINT64:
+                return func(std::integral_constant<ProtoType, ProtoType::SInt64>());
+            case pb::FieldDescriptor::TYPE_GROUP:
+                break;
+        }
+        throw std::runtime_error("Groups are not supported, field " + fdesc->name());
+    }
+
+    /// Returns wire type of the single value of the field
+    static WireType wireType(const pb::FieldDescriptor* fdesc)
+    {
+        if (fdesc->type() == pb::FieldDescriptor::TYPE_GROUP) {
+            throw std::runtime_error("Groups are not supported, field " + fdesc->name());
+        }
+        return wireTypeOf(ProtoType(fdesc->type()));
+    }
+
+    /// Checks if the default value of the field is not written (proto3 singular scalar)
+    static bool isImplicit(const pb::FieldDescriptor* fdesc)
+    {
+        return !fdesc->is_repeated() && !fdesc->containing_oneof() && fdesc->cpp_type() != pb::FieldDescriptor::CPPTYPE_MESSAGE &&
+               fdesc->file()->syntax() == pb::FileDescriptor::SYNTAX_PROTO3;
+    }
+
+    /// Returns value field of the map entry. Keys of pack maps are strings, so the map key has to be a string too.
+    static const pb::FieldDescriptor* mapValue(const pb::FieldDescriptor* fdesc)
+    {
+        if (!fdesc->is_map()) {
+            throw std::runtime_error("Field " + fdesc->name() + " is not a map");
+        }
+        if (fdesc->message_type()->map_key()->type() != pb::FieldDescriptor::TYPE_STRING) {
+            throw std::runtime_error("Key of map " + fdesc->name() + " is not a string");
         }
+        return fdesc->message_type()->map_value();
     }
 
-    static void decode(ValueMap<ValType>& /*node*/, const ConstWalkType& /*proto*/)
+    static void writeTag(std::string& out, const pb::FieldDescriptor* fdesc, WireType type)
     {
+        writeTag(out, fdesc->number(), type);
+    }
+
+    /// Writes single value (without tag) as the field type requires
+    template <typename T>
+    static void writeValue(std::string& out, const pb::FieldDescriptor* fdesc, const T& val)
+    {
+        withType(fdesc, [&](auto type) {
+            write<decltype(type)::value>(out, val);
+        });
+    }
+
+    /// Returns single value of the field as `T`
+    template <typename T>
+    static T readValue(const pb::FieldDescriptor* fdesc, const Field& field)
+    {
+        T ret{};
+        withType(fdesc, [&](auto type) {
+            ret = read<decltype(type)::value, T>(field);
+        });
+        return ret;
+    }
+
+    /// Returns the value of the absent field: declared default (proto2 `[default = ...]`) or empty one. The content of the
+    /// field is kept in `buffer`.
+    static Field defaultField(const pb::FieldDescriptor* fdesc, std::string& buffer)
+    {
+        Field field;
+        field.number = fdesc->number();
+        field.type   = wireType(fdesc);
+        if (!fdesc->has_default_value()) {
+            return field;
+        }
+
+        buffer.clear();
+        writeTag(buffer, fdesc, field.type);
+        switch (fdesc->cpp_type()) {
+            case pb::FieldDescriptor::CPPTYPE_INT32:
+                writeValue(buffer, fdesc, fdesc->default_value_int32());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_INT64:
+                writeValue(buffer, fdesc, fdesc->default_value_int64());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_UINT32:
+                writeValue(buffer, fdesc, fdesc->default_value_uint32());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_UINT64:
+                writeValue(buffer, fdesc, fdesc->default_value_uint64());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_DOUBLE:
+                writeValue(buffer, fdesc, fdesc->default_value_double());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_FLOAT:
+                writeValue(buffer, fdesc, fdesc->default_value_float());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_BOOL:
+                writeValue(buffer, fdesc, fdesc->default_value_bool());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_ENUM:
+                writeValue(buffer, fdesc, fdesc->default_value_enum()->number());
+                break;
+            case pb::FieldDescriptor::CPPTYPE_STRING:
+                writeValue(buffer, fdesc, std::string(fdesc->default_value_string()));
+                break;
+            case pb::FieldDescriptor::CPPTYPE_MESSAGE:
+                return field;
+        }
+        Reader(buffer).next(field);
+        return field;
     }
 
-    static void encode(const Value<ValType>& node, WalkType& proto)
+} // namespace wire
+
+/// Checks if there is active field mask, generated codecs are not aware of masks
+static bool isMasked()
+{
+    const FieldMask* mask = FieldMask::active();
+    return mask && !mask->empty();
+}
+
+// =========================================================================================================================================
+
+/// Writes protobuf wire format straight from the nodes, field numbers and types are taken from the message descriptor
+class WireEncoder : public Serialize<WireEncoder>
+{
+public:
+    struct Output
     {
-        auto refl = std::get<0>(proto)->GetReflection();
+        std::string&               out;
+        const pb::FieldDescriptor* field;
+    };
 
-        if constexpr (ValType == Type::Bool) {
-            refl->SetBool(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::Double) {
-            refl->SetDouble(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::Float) {
-            refl->SetFloat(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::Int32) {
-            refl->SetInt32(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::Int64) {
-            refl->SetInt64(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::String) {
-            refl->SetString(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::UInt32) {
-            refl->SetUInt32(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::UInt64) {
-            refl->SetUInt64(std::get<0>(proto), std::get<1>(proto), node.value());
-        } else if constexpr (ValType == Type::UChar) {
-            refl->SetUInt32(std::get<0>(proto), std::get<1>(proto), node.value());
+    /// Writes content of the message (without tag and length), generated codec of the node is used if there is one
+    static void message(const INode& node, const pb::Descriptor* descr, std::string& out, Option opt)
+    {
+        if (!isMasked() && node.encodeProto(out)) {
+            return;
         }
+
+        const Binding& bound = Binding::of(node, descr);
+        eachFieldAt(node, [&](size_t index, const Attribute& it) {
+            if (it.hasValue()) {
+                if (!bound.field(index)) {
+                    throw std::runtime_error("Cannot find " + it.key());
+                }
+                Output child{out, bound.field(index)};
+                visit(it, child, opt);
+            }
+        });
     }
 
-    static void encode(const ValueList<ValType>& node, WalkType& proto)
+    template <Type ValType>
+    static void packValue(const Value<ValType>& val, Output& res, Option /*opt*/)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
+        if (wire::isImplicit(res.field) && wire::isDefault(val.value())) {
+            return;
+        }
+        wire::writeTag(res.out, res.field, wire::wireType(res.field));
+        wire::writeValue(res.out, res.field, val.value());
+    }
 
+    template <Type ValType>
+    static void packValue(const ValueList<ValType>& list, Output& res, Option /*opt*/)
+    {
         if constexpr (ValType == Type::UChar) {
-            std::string str(node.value().begin(), node.value().end());
-            refl->SetString(std::get<0>(proto), std::get<1>(proto), str);
+            wire::writeTag(res.out, res.field, wire::WireType::Bytes);
+            wire::writeVarint(res.out, list.value().size());
+            res.out.append(list.value().begin(), list.value().end());
         } else {
-            auto setFunc = [&](const auto& val) {
-                if constexpr (ValType == Type::Bool) {
-                    refl->AddBool(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::Double) {
-                    refl->AddDouble(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::Float) {
-                    refl->AddFloat(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::Int32) {
-                    refl->AddInt32(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::Int64) {
-                    refl->AddInt64(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::String) {
-                    refl->AddString(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::UInt32) {
-                    refl->AddUInt32(std::get<0>(proto), std::get<1>(proto), val);
-                } else if constexpr (ValType == Type::UInt64) {
-                    refl->AddUInt64(std::get<0>(proto), std::get<1>(proto), val);
-                }
-            };
+            if (list.value().empty()) {
+                return;
+            }
 
-            if constexpr (ValType == Type::Bool) {
-                for (auto it : node) {
-                    setFunc(it);
-                }
+            if (res.field->is_packed()) {
+                wire::writeTag(res.out, res.field, wire::WireType::Bytes);
+                wire::withType(res.field, [&](auto type) {
+                    wire::writePacked<decltype(type)::value>(res.out, list.value());
+                });
             } else {
-                for (const auto& it : node) {
-                    setFunc(it);
+                for (const auto& it : list.value()) {
+                    wire::writeTag(res.out, res.field, wire::wireType(res.field));
+                    wire::writeValue(res.out, res.field, typename ValueList<ValType>::CppType(it));
                 }
             }
         }
     }
 
-    static void encode(const ValueMap<ValType>& /*node*/, WalkType& /*proto*/)
+    /// Map is written as repeated entry messages: key (1) and value (2)
+    template <Type ValType>
+    static void packValue(const ValueMap<ValType>& map, Output& res, Option /*opt*/)
+    {
+        const pb::FieldDescriptor* value = wire::mapValue(res.field);
+        for (const auto& [key, val] : map) {
+            wire::writeTag(res.out, res.field, wire::WireType::Bytes);
+            size_t start = wire::openLength(res.out);
+            wire::writeField<wire::ProtoType::String>(res.out, 1, key);
+            wire::writeTag(res.out, value, wire::wireType(value));
+            wire::writeValue(res.out, value, val);
+            wire::closeLength(res.out, start);
+        }
+    }
+
+    static void packValue(const IObjectMap& map, Output& res, Option opt)
+    {
+        Output value{res.out, wire::mapValue(res.field)};
+        for (int i = 0; i < map.size(); ++i) {
+            const auto& key = map.keyByIndex(i);
+            wire::writeTag(res.out, res.field, wire::WireType::Bytes);
+            size_t start = wire::openLength(res.out);
+            wire::writeField<wire::ProtoType::String>(res.out, 1, key);
+            visit(map.get(key), value, opt);
+            wire::closeLength(res.out, start);
+        }
+    }
+
+    static void packValue(const IObjectList& list, Output& res, Option opt)
+    {
+        for (int i = 0; i < list.size(); ++i) {
+            visit(list.get(i), res, opt);
+        }
+    }
+
+    static void packValue(const INode& node, Output& res, Option opt)
+    {
+        if (!res.field->message_type()) {
+            throw std::runtime_error("Field " + res.field->name() + " is not a message");
+        }
+        wire::writeTag(res.out, res.field, wire::WireType::Bytes);
+        size_t start = wire::openLength(res.out);
+        message(node, res.field->message_type(), res.out, opt);
+        wire::closeLength(res.out, start);
+    }
+
+    static void packValue(const IEnum& en, Output& res, Option /*opt*/)
     {
+        if (wire::isImplicit(res.field) && en.asInt() == 0) {
+            return;
+        }
+        wire::writeTag(res.out, res.field, wire::WireType::Varint);
+        wire::writeValue(res.out, res.field, en.asInt());
+    }
+
+    static void packValue(const IProtoMap& map, Output& res, Option opt)
+    {
+        for (int i = 0; i < map.size(); ++i) {
+            visit(map.get(i), res, opt);
+        }
+    }
+
+    /// Variant is written as the field of the oneof at the position of the active alternative
+    static void packValue(const IVariant& var, Output& res, Option opt)
+    {
+        const Attribute* alt = var.get();
+        if (!alt) {
+            return;
+        }
+        const pb::OneofDescriptor* oneof = res.field->containing_oneof();
+        if (!oneof || var.index() >= size_t(oneof->field_count())) {
+            throw std::runtime_error(
+                "Oneof of field " + res.field->name() + " has no field for alternative " + std::to_string(var.index()));
+        }
+        Output child{res.out, oneof->field(int(var.index()))};
+        visit(*alt, child, opt);
+    }
+
+    static void packValue(const ILazy& lazy, Output& res, Option opt)
+    {
+        if (lazy.format() == ILazy::Format::Protobuf) {
+            // Not touched, copied as is
+            wire::writeTag(res.out, res.field, wire::WireType::Bytes);
+            wire::writeVarint(res.out, lazy.raw().size());
+            res.out.append(lazy.raw());
+        } else {
+            visit(lazy.node(), res, opt);
+        }
     }
 };
 
+// =========================================================================================================================================
 
-class ProtoSerializer : public Serialize<ProtoSerializer>
+/// Counts size of the protobuf wire format WireEncoder writes, without writing it
+class WireSizer : public Serialize<WireSizer>
 {
 public:
-    using WalkType = std::tuple<pb::Message*, const pb::FieldDescriptor*>;
+    struct Output
+    {
+        size_t&                    size;
+        const pb::FieldDescriptor* field;
+    };
 
-    template <typename T>
-    static void packValue(const T& val, WalkType& proto, Option opt)
+    /// Returns size of the message content (without tag and length), generated codec of the node is used if there is one
+    static size_t message(const INode& node, const pb::Descriptor* descr, Option opt)
     {
-        if (val.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
-            Convert<T::ThisType>::encode(val, proto);
+        size_t size = 0;
+        if (!isMasked() && node.protoSize(size)) {
+            return size;
         }
-    }
 
-    static void packValue(const IObjectMap& /*val*/, WalkType& /*proto*/, Option /*opt*/)
-    {
+        const Binding& bound = Binding::of(node, descr);
+        eachFieldAt(node, [&](size_t index, const Attribute& it) {
+            if (it.hasValue()) {
+                if (!bound.field(index)) {
+                    throw std::runtime_error("Cannot find " + it.key());
+                }
+                Output child{size, bound.field(index)};
+                visit(it, child, opt);
+            }
+        });
+        return size;
     }
 
-    static void packValue(const IObjectList& val, WalkType& proto, Option opt)
+    template <Type ValType>
+    static void packValue(const Value<ValType>& val, Output& res, Option /*opt*/)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
-        for (int i = 0; i < val.size(); ++i) {
-            const Attribute& node       = val.get(i);
-            pb::Message*     child      = refl->AddMessage(std::get<0>(proto), std::get<1>(proto));
-            auto             childProto = std::make_tuple(child, std::get<1>(proto));
-            visit(node, childProto, opt);
+        if (wire::isImplicit(res.field) && wire::isDefault(val.value())) {
+            return;
         }
+        res.size += wire::tagSize(res.field->number()) + valueSize(res.field, val.value());
     }
 
-    static void packValue(const INode& node, WalkType& proto, Option opt)
+    template <Type ValType>
+    static void packValue(const ValueList<ValType>& list, Output& res, Option /*opt*/)
     {
-        for (auto& it : node.fields()) {
-            if (it->hasValue()) {
-                auto fdesc = std::get<0>(proto)->GetDescriptor()->FindFieldByName(it->key());
-                if (fdesc && fdesc->cpp_type() == pb::FieldDescriptor::CPPTYPE_MESSAGE && !fdesc->is_repeated()) {
-                    auto refl  = std::get<0>(proto)->GetReflection();
-                    auto child = WalkType(refl->MutableMessage(std::get<0>(proto), fdesc), fdesc);
-                    visit(*it, child, opt);
-                } else if (fdesc) {
-                    auto child = WalkType(std::get<0>(proto), fdesc);
-                    visit(*it, child, opt);
-                } else {
-                    throw std::runtime_error("Cannot find " + it->key());
+        if constexpr (ValType == Type::UChar) {
+            res.size += wire::tagSize(res.field->number()) + wire::lengthSize(list.value().size());
+        } else {
+            if (list.value().empty()) {
+                return;
+            }
+
+            if (res.field->is_packed()) {
+                wire::withType(res.field, [&](auto type) {
+                    res.size += wire::tagSize(res.field->number()) + wire::packedSize<decltype(type)::value>(list.value());
+                });
+            } else {
+                for (const auto& it : list.value()) {
+                    res.size += wire::tagSize(res.field->number()) + valueSize(res.field, typename ValueList<ValType>::CppType(it));
                 }
             }
         }
     }
 
-    static void packValue(const IEnum& en, WalkType& proto, Option /*opt*/)
+    template <Type ValType>
+    static void packValue(const ValueMap<ValType>& map, Output& res, Option /*opt*/)
+    {
+        const pb::FieldDescriptor* value = wire::mapValue(res.field);
+        for (const auto& [key, val] : map) {
+            size_t entry = wire::fieldSize<wire::ProtoType::String>(1, key) + wire::tagSize(value->number()) + valueSize(value, val);
+            res.size += wire::tagSize(res.field->number()) + wire::lengthSize(entry);
+        }
+    }
+
+    static void packValue(const IObjectMap& map, Output& res, Option opt)
+    {
+        for (int i = 0; i < map.size(); ++i) {
+            const auto& key   = map.keyByIndex(i);
+            size_t      entry = wire::fieldSize<wire::ProtoType::String>(1, key);
+            Output      value{entry, wire::mapValue(res.field)};
+            visit(map.get(key), value, opt);
+            res.size += wire::tagSize(res.field->number()) + wire::lengthSize(entry);
+        }
+    }
+
+    static void packValue(const IObjectList& list, Output& res, Option opt)
+    {
+        for (int i = 0; i < list.size(); ++i) {
+            visit(list.get(i), res, opt);
+        }
+    }
+
+    static void packValue(const INode& node, Output& res, Option opt)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
-        refl->SetEnumValue(std::get<0>(proto), std::get<1>(proto), en.asInt());
+        if (!res.field->message_type()) {
+            throw std::runtime_error("Field " + res.field->name() + " is not a message");
+        }
+        res.size += wire::tagSize(res.field->number()) + wire::lengthSize(message(node, res.field->message_type(), opt));
+    }
+
+    static void packValue(const IEnum& en, Output& res, Option /*opt*/)
+    {
+        if (wire::isImplicit(res.field) && en.asInt() == 0) {
+            return;
+        }
+        res.size += wire::tagSize(res.field->number()) + valueSize(res.field, en.asInt());
     }
 
-    static void packValue(const IProtoMap& map, WalkType& proto, Option opt)
+    static void packValue(const IProtoMap& map, Output& res, Option opt)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
         for (int i = 0; i < map.size(); ++i) {
-            const INode& node       = map.get(i);
-            pb::Message* child      = refl->AddMessage(std::get<0>(proto), std::get<1>(proto));
-            auto         childProto = std::make_tuple(child, std::get<1>(proto));
-            visit(node, childProto, opt);
+            visit(map.get(i), res, opt);
         }
     }
 
-    static void packValue(const IVariant& /*var*/, WalkType& /*proto*/, Option /*opt*/)
+    static void packValue(const IVariant& var, Output& res, Option opt)
     {
+        const Attribute* alt = var.get();
+        if (!alt) {
+            return;
+        }
+        const pb::OneofDescriptor* oneof = res.field->containing_oneof();
+        if (!oneof || var.index() >= size_t(oneof->field_count())) {
+            throw std::runtime_error(
+                "Oneof of field " + res.field->name() + " has no field for alternative " + std::to_string(var.index()));
+        }
+        Output child{res.size, oneof->field(int(var.index()))};
+        visit(*alt, child, opt);
+    }
+
+    static void packValue(const ILazy& lazy, Output& res, Option opt)
+    {
+        if (lazy.format() == ILazy::Format::Protobuf) {
+            res.size += wire::tagSize(res.field->number()) + wire::lengthSize(lazy.raw().size());
+        } else {
+            visit(lazy.node(), res, opt);
+        }
+    }
+
+private:
+    template <typename T>
+    static size_t valueSize(const pb::FieldDescriptor* fdesc, const T& val)
+    {
+        size_t size = 0;
+        wire::withType(fdesc, [&](auto type) {
+            size = wire::valueSize<decltype(type)::value>(val);
+        });
+        return size;
     }
 };
 
-class ProtoDeserializer : public Deserialize<ProtoDeserializer>
+// =========================================================================================================================================
+
+/// Reads protobuf wire format straight into the nodes
+class WireDecoder : public Deserialize<WireDecoder>
 {
 public:
-    using WalkType = std::tuple<const pb::Message*, const pb::FieldDescriptor*>;
+    struct Input
+    {
+        const pb::FieldDescriptor* field;
+        wire::Field                value;
+    };
 
-    template <typename T>
-    static void unpackValue(T& val, const WalkType& proto)
+    /// Reads content of the message. Fields which are not in the content are set to default and repeated fields are
+    /// replaced, as protobuf does, so the node could be reused. Generated codec of the node is used if there is one.
+    static void message(INode& node, const pb::Descriptor* descr, std::string_view content)
     {
-        Convert<T::ThisType>::decode(val, proto);
+        if (!isMasked() && node.decodeProto(content)) {
+            return;
+        }
+
+        const Binding&   bound = Binding::of(node, descr);
+        const FieldMask* mask  = FieldMask::active();
+        const auto*      sel   = mask && !mask->empty() ? &mask->select(node) : nullptr;
+        const auto       flds  = node.fields();
+
+        auto read = [&](size_t index, const Input& input) {
+            if (sel) {
+                FieldMask::Scope scope(sel->children[index]);
+                visit(*flds[index], input);
+            } else {
+                visit(*flds[index], input);
+            }
+        };
+
+        std::vector<bool> seen(flds.size(), false);
+        wire::Reader      reader(content);
+        wire::Field       value;
+        while (reader.next(value)) {
+            size_t index;
+            if (!bound.find(value.number, index) || (sel && !sel->fields[index])) {
+                continue;
+            }
+            if (!seen[index] && (flds[index]->type() == Attribute::NodeType::List || flds[index]->type() == Attribute::NodeType::Map)) {
+                // Previous content of the repeated field, the values are appended by the field occurrences
+                flds[index]->clear();
+            }
+            seen[index] = true;
+            read(index, Input{bound.field(index), value});
+        }
+
+        std::string buffer;
+        for (size_t i = 0; i < flds.size(); ++i) {
+            if (seen[i] || !bound.field(i) || (sel && !sel->fields[i])) {
+                continue;
+            }
+            switch (flds[i]->type()) {
+                case Attribute::NodeType::Value:
+                case Attribute::NodeType::Enum:
+                case Attribute::NodeType::Node:
+                case Attribute::NodeType::Lazy:
+                    read(i, Input{bound.field(i), wire::defaultField(bound.field(i), buffer)});
+                    break;
+                case Attribute::NodeType::List:
+                case Attribute::NodeType::Map:
+                case Attribute::NodeType::Variant:
+                    flds[i]->clear();
+                    break;
+            }
+        }
     }
 
-    static void unpackValue(IEnum& en, const WalkType& proto)
+    template <Type ValType>
+    static void unpackValue(Value<ValType>& val, const Input& input)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
-        int  val  = refl->GetEnumValue(*std::get<0>(proto), std::get<1>(proto));
-        en.fromInt(val);
+        val = wire::readValue<typename Value<ValType>::CppType>(input.field, input.value);
     }
 
-    static void unpackValue(IObjectMap& /*list*/, const WalkType& /*proto*/)
+    template <Type ValType>
+    static void unpackValue(ValueList<ValType>& list, const Input& input)
     {
+        if constexpr (ValType == Type::UChar) {
+            if (input.value.type != wire::WireType::Bytes) {
+                throw std::runtime_error("Wrong wire type of field " + input.field->name());
+            }
+            list.setValue(typename ValueList<ValType>::ListType(input.value.bytes.begin(), input.value.bytes.end()));
+        } else {
+            wire::withType(input.field, [&](auto type) {
+                wire::readList<decltype(type)::value>(input.value, list);
+            });
+        }
     }
 
-    static void unpackValue(IObjectList& list, const WalkType& proto)
+    template <Type ValType>
+    static void unpackValue(ValueMap<ValType>& map, const Input& input)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
+        using CppType = typename ValueMap<ValType>::CppType;
 
-        for (int i = 0; i < refl->FieldSize(*std::get<0>(proto), std::get<1>(proto)); ++i) {
-            const pb::Message& msg   = refl->GetRepeatedMessage(*std::get<0>(proto), std::get<1>(proto), i);
-            auto&              obj   = list.create();
-            auto               child = WalkType(&msg, nullptr);
-            visit(obj, child);
+        const pb::FieldDescriptor* vdesc = wire::mapValue(input.field);
+        wire::Field                value;
+        std::string                key = entry(input, value);
+        CppType                    val = value.number ? wire::readValue<CppType>(vdesc, value) : CppType{};
+        if (map.contains(key)) {
+            map.set(key, val);
+        } else {
+            map.append(key, val);
         }
     }
 
-    static void unpackValue(INode& node, const WalkType& proto)
+    static void unpackValue(IEnum& en, const Input& input)
     {
-        for (auto& it : node.fields()) {
-            auto fdesc = std::get<0>(proto)->GetDescriptor()->FindFieldByName(it->key());
-            if (fdesc && fdesc->cpp_type() == pb::FieldDescriptor::CPPTYPE_MESSAGE && !fdesc->is_repeated()) {
-                auto refl  = std::get<0>(proto)->GetReflection();
-                auto child = WalkType(&refl->GetMessage(*std::get<0>(proto), fdesc), fdesc);
-                visit(*it, child);
-            } else if (fdesc) {
-                auto child = WalkType(std::get<0>(proto), fdesc);
-                visit(*it, child);
-            }
+        en.fromInt(wire::readValue<int>(input.field, input.value));
+    }
+
+    static void unpackValue(IObjectMap& map, const Input& input)
+    {
+        const pb::FieldDescriptor* vdesc = wire::mapValue(input.field);
+        wire::Field                value;
+        Attribute&                 item = map.create(entry(input, value));
+        if (value.number) {
+            visit(item, Input{vdesc, value});
         }
     }
 
-    static void unpackValue(IProtoMap& map, const WalkType& proto)
+    static void unpackValue(IObjectList& list, const Input& input)
+    {
+        visit(list.create(), input);
+    }
+
+    static void unpackValue(INode& node, const Input& input)
     {
-        auto refl = std::get<0>(proto)->GetReflection();
+        if (!input.field->message_type() || input.value.type != wire::WireType::Bytes) {
+            throw std::runtime_error("Field " + input.field->name() + " is not a message");
+        }
+        message(node, input.field->message_type(), input.value.bytes);
+    }
 
-        for (int i = 0; i < refl->FieldSize(*std::get<0>(proto), std::get<1>(proto)); ++i) {
-            const pb::Message& msg = refl->GetRepeatedMessage(*std::get<0>(proto), std::get<1>(proto), i);
+    static void unpackValue(IProtoMap& map, const Input& input)
+    {
+        visit(map.create(), input);
+    }
+
+    /// Alternative is chosen by the position of the oneof field in the content
+    static void unpackValue(IVariant& var, const Input& input)
+    {
+        const pb::OneofDescriptor* oneof = input.field->containing_oneof();
+        for (int i = 0; oneof && i < oneof->field_count(); ++i) {
+            if (oneof->field(i)->number() == input.value.number) {
+                if (Attribute* alt = var.resetAt(size_t(i))) {
+                    visit(*alt, Input{oneof->field(i), input.value});
+                }
+                return;
+            }
+        }
+        throw std::runtime_error("Variant " + var.key() + " has no alternative for field " + std::to_string(input.value.number));
+    }
 
-            auto& obj   = map.create();
-            auto  child = WalkType(&msg, nullptr);
-            visit(obj, child);
+    static void unpackValue(ILazy& lazy, const Input& input)
+    {
+        if (input.value.type != wire::WireType::Bytes) {
+            throw std::runtime_error("Field " + input.field->name() + " is not a message");
         }
+        lazy.setRaw(ILazy::Format::Protobuf, std::string(input.value.bytes));
     }
 
-    static void unpackValue(IVariant& /*var*/, const WalkType& /*proto*/)
+private:
+    /// Reads the map entry, returns its key. Number of `value` is 0 if there is no value in the entry.
+    static std::string entry(const Input& input, wire::Field& value)
     {
+        std::string  key;
+        wire::Reader reader(wire::content(input.value));
+        wire::Field  field;
+        value.number = 0;
+        while (reader.next(field)) {
+            if (field.number == 1) {
+                key = wire::read<wire::ProtoType::String, std::string>(field);
+            } else if (field.number == 2) {
+                value = field;
+            }
+        }
+        return key;
     }
 };
 
+// =========================================================================================================================================
 
 namespace protobuf {
 
-    static pb::Message* getMessage(const Attribute& attr)
+    /// Message descriptors by proto name. Descriptors are loaded from the node file descriptor on the first use of the
+    /// type (or by preload), after that every thread resolves the type from its own cache without locking.
+    class Registry
     {
-        if (const INode* node = dynamic_cast<const INode*>(&attr)) {
-            static pb::SimpleDescriptorDatabase db;
-            static pb::DescriptorPool           pool(&db);
+    public:
+        static Registry& instance()
+        {
+            static Registry registry;
+            return registry;
+        }
 
-            auto descr = pool.FindMessageTypeByName(node->protoName());
-            if (!descr) {
-                pb::FileDescriptorSet fs;
-                fs.ParseFromString(node->fileDescriptor());
-                for (int i = 0; i < fs.file().size(); ++i) {
-                    if (!pool.FindFileByName(fs.file(i).name())) {
-                        db.Add(fs.file(i));
-                    }
+        static const pb::Descriptor* descriptor(const INode& node)
+        {
+            thread_local std::unordered_map<std::string, const pb::Descriptor*> cache;
+
+            std::string name = node.protoName();
+            if (auto it = cache.find(name); it != cache.end()) {
+                return it->second;
+            }
+
+            const pb::Descriptor* descr = instance().load(node, name);
+            cache.emplace(std::move(name), descr);
+            return descr;
+        }
+
+        /// Adds all the files of the descriptor set and builds them. Set is parsed without lock, so many sets could be
+        /// added concurrently.
+        void build(const std::string& fileDescriptor)
+        {
+            pb::FileDescriptorSet fs;
+            if (!fs.ParseFromString(fileDescriptor)) {
+                throw std::runtime_error("Cannot parse file descriptor set");
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            add(fs);
+            for (int i = 0; i < fs.file().size(); ++i) {
+                if (!m_pool.FindFileByName(fs.file(i).name())) {
+                    throw std::runtime_error("Cannot build descriptor of " + fs.file(i).name());
+                }
+            }
+        }
+
+    private:
+        const pb::Descriptor* load(const INode& node, const std::string& name)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (auto descr = m_pool.FindMessageTypeByName(name)) {
+                    return descr;
                 }
-                descr = pool.FindMessageTypeByName(node->protoName());
             }
 
+            pb::FileDescriptorSet fs;
+            if (!fs.ParseFromString(node.fileDescriptor())) {
+                throw std::runtime_error("Cannot parse file descriptor set of " + name);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            add(fs);
+            auto descr = m_pool.FindMessageTypeByName(name);
             if (!descr) {
-                throw std::runtime_error("Cannot find description for " + node->protoName());
+                throw std::runtime_error("Cannot find description for " + name);
             }
+            return descr;
+        }
 
-            static pb::DynamicMessageFactory dmf(&pool);
-            const pb::Message*               protoMsg = dmf.GetPrototype(descr);
-            return protoMsg->New();
+        /// Adds new files to the database, pool builds them on the first lookup. Should be called under the lock.
+        void add(const pb::FileDescriptorSet& fs)
+        {
+            for (int i = 0; i < fs.file().size(); ++i) {
+                // Not asking the pool, it remembers files which were not found
+                if (m_files.insert(fs.file(i).name()).second) {
+                    m_db.Add(fs.file(i));
+                }
+            }
+        }
+
+    private:
+        std::mutex                      m_mutex;
+        std::unordered_set<std::string> m_files;
+        pb::SimpleDescriptorDatabase    m_db;
+        pb::DescriptorPool              m_pool{&m_db};
+    };
+
+    /// Appends encoded message to `out`
+    static void encode(const Attribute& attr, std::string& out, Option opt)
+    {
+        const INode* node = dynamic_cast<const INode*>(&attr);
+        if (!node) {
+            throw std::runtime_error("Not a message");
         }
-        return nullptr;
+        WireEncoder::message(*node, Registry::descriptor(*node), out, opt);
     }
 
     fty::Expected<std::string> serialize(const Attribute& node, Option opt)
     {
+        std::string out;
+        if (auto ret = serialize(node, out, opt); !ret) {
+            return fty::unexpected(ret.error());
+        }
+        return out;
+    }
+
+    fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt)
+    {
+        FieldMask::Scope scope(&mask);
+        return serialize(node, opt);
+    }
+
+    fty::Expected<void> serialize(const Attribute& node, std::string& out, Option opt)
+    {
+        size_t size = out.size();
         try {
-            std::unique_ptr<pb::Message> msg(getMessage(node));
+            encode(node, out, opt);
+            return {};
+        } catch (std::exception& ex) {
+            out.resize(size);
+            return fty::unexpected(ex.what());
+        }
+    }
 
-            auto proto = ProtoSerializer::WalkType(msg.get(), nullptr);
-            ProtoSerializer::visit(node, proto, opt);
+    /// Encodes message into the thread buffer, content is valid till the next call in the thread
+    static std::string_view encodeScratch(const Attribute& node, Option opt)
+    {
+        thread_local std::string buffer;
+        buffer.clear();
+        encode(node, buffer, opt);
+        return buffer;
+    }
 
-            return msg->SerializeAsString();
-        } catch (google::protobuf::FatalException& ex) {
-            return fty::unexpected(ex.message());
+    fty::Expected<size_t> serializedSize(const Attribute& node, Option opt)
+    {
+        try {
+            const INode* msg = dynamic_cast<const INode*>(&node);
+            if (!msg) {
+                throw std::runtime_error("Not a message");
+            }
+            return WireSizer::message(*msg, Registry::descriptor(*msg), opt);
         } catch (std::exception& ex) {
             return fty::unexpected(ex.what());
         }
     }
 
-    fty::Expected<void> deserialize(const std::string& content, Attribute& node)
+    fty::Expected<void> serialize(const Attribute& node, std::ostream& out, Option opt)
     {
         try {
-            std::unique_ptr<pb::Message> msg(getMessage(node));
-            try {
-                msg->ParseFromString(content);
-            } catch (google::protobuf::FatalException& ex) {
-                return fty::unexpected(ex.message());
+            std::string_view buffer = encodeScratch(node, opt);
+            if (!out.write(buffer.data(), std::streamsize(buffer.size()))) {
+                return fty::unexpected("Cannot write message to the stream");
+            }
+            return {};
+        } catch (std::exception& ex) {
+            return fty::unexpected(ex.what());
+        }
+    }
+
+    fty::Expected<void> serialize(const Attribute& node, pb::io::ZeroCopyOutputStream& out, Option opt)
+    {
+        try {
+            std::string_view buffer = encodeScratch(node, opt);
+            while (!buffer.empty()) {
+                void* data = nullptr;
+                int   size = 0;
+                if (!out.Next(&data, &size)) {
+                    return fty::unexpected("Cannot write message to the stream");
+                }
+                size_t count = std::min(buffer.size(), size_t(size));
+                memcpy(data, buffer.data(), count);
+                buffer.remove_prefix(count);
+                if (count < size_t(size)) {
+                    out.BackUp(int(size_t(size) - count));
+                }
+            }
+            return {};
+        } catch (std::exception& ex) {
+            return fty::unexpected(ex.what());
+        }
+    }
+
+    fty::Expected<void> serializeToFd(const Attribute& node, int fd, Option opt)
+    {
+        try {
+            std::string_view buffer = encodeScratch(node, opt);
+            while (!buffer.empty()) {
+                ssize_t written = ::write(fd, buffer.data(), buffer.size());
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return fty::unexpected("Cannot write message: {}", strerror(errno));
+                }
+                buffer.remove_prefix(size_t(written));
+            }
+            return {};
+        } catch (std::exception& ex) {
+            return fty::unexpected(ex.what());
+        }
+    }
+
+    fty::Expected<void> serializeFile(const std::string& fileName, const Attribute& node, Option opt)
+    {
+        int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return fty::unexpected("Cannot write file {}", fileName);
+        }
+        auto ret = serializeToFd(node, fd, opt);
+        if (::close(fd) != 0 && ret) {
+            return fty::unexpected("Cannot write file {}", fileName);
+        }
+        return ret;
+    }
+
+    /// Serializes elements into the batch
+    template <typename Get>
+    static fty::Expected<void> serializeBatch(size_t count, Get&& get, Batch& out, Option opt)
+    {
+        size_t bufferSize = out.buffer.size();
+        size_t slicesSize = out.slices.size();
+        size_t i          = 0;
+
+        try {
+            out.slices.reserve(slicesSize + count);
+            for (; i < count; ++i) {
+                size_t offset = out.buffer.size();
+                encode(*get(i), out.buffer, opt);
+                out.slices.push_back({offset, out.buffer.size() - offset});
             }
+            return {};
+        } catch (std::exception& ex) {
+            out.buffer.resize(bufferSize);
+            out.slices.resize(slicesSize);
+            return fty::unexpected("Element {}: {}", i, ex.what());
+        }
+    }
+
+    fty::Expected<void> serialize(const std::vector<const Attribute*>& nodes, Batch& out, Option opt)
+    {
+        return serializeBatch(
+            nodes.size(),
+            [&](size_t i) {
+                return nodes[i];
+            },
+            out, opt);
+    }
 
-            auto proto = ProtoDeserializer::WalkType(msg.get(), nullptr);
-            ProtoDeserializer::visit(node, proto);
+    fty::Expected<void> serialize(const IObjectList& list, Batch& out, Option opt)
+    {
+        return serializeBatch(
+            size_t(list.size()),
+            [&](size_t i) {
+                return &list.get(int(i));
+            },
+            out, opt);
+    }
+
+    fty::Expected<void> deserialize(std::string_view content, Attribute& node)
+    {
+        try {
+            INode* msg = dynamic_cast<INode*>(&node);
+            if (!msg) {
+                return fty::unexpected("Not a message");
+            }
+            WireDecoder::message(*msg, Registry::descriptor(*msg), content);
             return {};
         } catch (const std::exception& e) {
             return fty::unexpected(e.what());
         }
     }
 
+    fty::Expected<void> preload(const std::vector<const INode*>& nodes, size_t threads)
+    {
+        return parallelFor(nodes.size(), threads, [&](size_t i) -> fty::Expected<void> {
+            try {
+                if (!nodes[i]) {
+                    return fty::unexpected("Node is null");
+                }
+                Registry::descriptor(*nodes[i]);
+                return {};
+            } catch (const std::exception& ex) {
+                return fty::unexpected("{}: {}", nodes[i]->protoName(), ex.what());
+            }
+        });
+    }
+
+    fty::Expected<void> preloadAll(size_t threads)
+    {
+        std::vector<FileDescriptorFunc> files = registeredFileDescriptors();
+        return parallelFor(files.size(), threads, [&](size_t i) -> fty::Expected<void> {
+            try {
+                Registry::instance().build(files[i]());
+                return {};
+            } catch (const std::exception& ex) {
+                return fty::unexpected(ex.what());
+            }
+        });
+    }
+
+    struct Context::Impl
+    {
+        std::string                                                buffer;
+        std::unordered_map<std::type_index, const pb::Descriptor*> descriptors;
+
+        const pb::Descriptor* descriptor(const INode& node)
+        {
+            auto it = descriptors.find(typeid(node));
+            if (it == descriptors.end()) {
+                it = descriptors.emplace(typeid(node), Registry::descriptor(node)).first;
+            }
+            return it->second;
+        }
+    };
+
+    Context::Context()
+        : m_impl(std::make_unique<Impl>())
+    {
+    }
+
+    Context::~Context() = default;
+
+    fty::Expected<std::string_view> Context::serialize(const Attribute& attr, Option opt)
+    {
+        m_impl->buffer.clear();
+        try {
+            const INode* node = dynamic_cast<const INode*>(&attr);
+            if (!node) {
+                return fty::unexpected("Not a message");
+            }
+            WireEncoder::message(*node, m_impl->descriptor(*node), m_impl->buffer, opt);
+            return std::string_view(m_impl->buffer);
+        } catch (const std::exception& ex) {
+            return fty::unexpected(ex.what());
+        }
+    }
+
+    fty::Expected<void> Context::deserialize(std::string_view content, Attribute& attr)
+    {
+        try {
+            INode* node = dynamic_cast<INode*>(&attr);
+            if (!node) {
+                return fty::unexpected("Not a message");
+            }
+            WireDecoder::message(*node, m_impl->descriptor(*node), content);
+            return {};
+        } catch (const std::exception& ex) {
+            return fty::unexpected(ex.what());
+        }
+    }
+
+    fty::Expected<void> deserializeMany(
+        const std::vector<std::string_view>& payloads, const std::vector<Attribute*>& nodes, size_t threads)
+    {
+        if (payloads.size() != nodes.size()) {
+            return fty::unexpected("Count of payloads ({}) and nodes ({}) differs", payloads.size(), nodes.size());
+        }
+        return parallelFor(payloads.size(), threads, [&](size_t i) -> fty::Expected<void> {
+            if (!nodes[i]) {
+                return fty::unexpected("Node is null");
+            }
+            return deserialize(payloads[i], *nodes[i]);
+        });
+    }
+
+    fty::Expected<void> deserialize(std::string_view content, Attribute& node, const FieldMask& mask)
+    {
+        FieldMask::Scope scope(&mask);
+        return deserialize(content, node);
+    }
+
+    fty::Expected<void> serializeDelimited(std::ostream& out, const Attribute& node, Option opt)
+    {
+        try {
+            std::string_view buffer = encodeScratch(node, opt);
+            std::string      prefix;
+            wire::writeVarint(prefix, buffer.size());
+            if (!out.write(prefix.data(), std::streamsize(prefix.size())) ||
+                !out.write(buffer.data(), std::streamsize(buffer.size()))) {
+                return fty::unexpected("Cannot write message to the stream");
+            }
+            return {};
+        } catch (const std::exception& ex) {
+            return fty::unexpected(ex.what());
+        }
+    }
+
+    fty::Expected<void> serializeDelimited(std::ostream& out, const IObjectList& list, Option opt)
+    {
+        for (int i = 0; i < list.size(); ++i) {
+            if (auto ret = serializeDelimited(out, list.get(i), opt); !ret) {
+                return fty::unexpected("Element {}: {}", i, ret.error());
+            }
+        }
+        return {};
+    }
+
+    /// Reads varint length prefix of the next message, returns false at the end of the stream
+    static bool readLength(std::istream& in, uint64_t& len)
+    {
+        len = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            if (byte == std::char_traits<char>::eof()) {
+                if (shift == 0) {
+                    return false;
+                }
+                throw std::runtime_error("Broken protobuf stream: truncated length");
+            }
+            len |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        throw std::runtime_error("Broken protobuf stream: malformed length");
+    }
+
+    fty::Expected<void> deserializeDelimited(std::istream& in, Attribute& item, const std::function<void()>& func)
+    {
+        std::string buffer;
+        uint64_t    len;
+        size_t      num = 0;
+        for (;; ++num) {
+            try {
+                if (!readLength(in, len)) {
+                    return {};
+                }
+                if (len > uint64_t(std::numeric_limits<int>::max())) {
+                    throw std::runtime_error("Message is too big");
+                }
+                buffer.resize(size_t(len));
+                if (!in.read(buffer.data(), std::streamsize(len))) {
+                    throw std::runtime_error("Broken protobuf stream: truncated message");
+                }
+                item.clear();
+                if (auto ret = deserialize(buffer, item); !ret) {
+                    throw std::runtime_error(ret.error());
+                }
+            } catch (const std::exception& e) {
+                return fty::unexpected("Message {}: {}", num, e.what());
+            }
+            func();
+        }
+    }
+
+    fty::Expected<void> deserializeDelimited(std::string_view content, Attribute& item, const std::function<void()>& func)
+    {
+        wire::Reader     reader(content);
+        std::string_view message;
+        size_t           num = 0;
+        for (;; ++num) {
+            try {
+                if (!reader.nextDelimited(message)) {
+                    return {};
+                }
+                item.clear();
+                if (auto ret = deserialize(message, item); !ret) {
+                    throw std::runtime_error(ret.error());
+                }
+            } catch (const std::exception& e) {
+                return fty::unexpected("Message {}: {}", num, e.what());
+            }
+            func();
+        }
+    }
+
+    /// Read only memory mapping of the whole file
+    class MappedFile
+    {
+    public:
+        ~MappedFile()
+        {
+            if (m_data != MAP_FAILED) {
+                munmap(m_data, m_size);
+            }
+            if (m_fd >= 0) {
+                ::close(m_fd);
+            }
+        }
+
+        fty::Expected<std::string_view> open(const std::string& fileName)
+        {
+            m_fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (m_fd < 0 || fstat(m_fd, &st) != 0) {
+                return fty::unexpected("Cannot read file {}", fileName);
+            }
+            m_size = size_t(st.st_size);
+            if (m_size == 0) {
+                // Empty message, nothing to map
+                return std::string_view();
+            }
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (m_data == MAP_FAILED) {
+                return fty::unexpected("Cannot map file {}: {}", fileName, strerror(errno));
+            }
+            return std::string_view(static_cast<const char*>(m_data), m_size);
+        }
+
+    private:
+        int    m_fd   = -1;
+        void*  m_data = MAP_FAILED;
+        size_t m_size = 0;
+    };
+
+    fty::Expected<void> deserializeFile(const std::string& fileName, Attribute& node)
+    {
+        MappedFile file;
+        if (auto cnt = file.open(fileName)) {
+            return deserialize(*cnt, node);
+        } else {
+            return fty::unexpected(cnt.error());
+        }
+    }
+
 } // namespace protobuf
 
 } // namespace pack
@@ -0,0 +1,203 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#include "pack/pack.h"
+#include "pack/serialization.h"
+#include "pack/visitor.h"
+#include "base64.h"
+#include "json.h"
+#include "utils.h"
+#include <simdjson.h>
+
+// Json deserialization backend based on simdjson parser. Used instead of nlohmann parser when built with WITH_SIMDJSON.
+// DOM api is used: visitor needs random access to the members (fields are looked up by key, variants scan keys before
+// unpacking), which on-demand api does not allow.
+
+namespace pack::json {
+
+namespace sj = ::simdjson;
+
+// =========================================================================================================================================
+
+template <typename T>
+static T number(const sj::dom::element& json)
+{
+    switch (json.type()) {
+        case sj::dom::element_type::INT64:
+            return static_cast<T>(json.get_int64().value());
+        case sj::dom::element_type::UINT64:
+            return static_cast<T>(json.get_uint64().value());
+        case sj::dom::element_type::DOUBLE:
+            return static_cast<T>(json.get_double().value());
+        case sj::dom::element_type::BOOL:
+            return static_cast<T>(json.get_bool().value());
+        case sj::dom::element_type::STRING:
+            return fty::convert<T>(std::string(json.get_string().value()));
+        default:
+            throw std::runtime_error("Json value is not a number");
+    }
+}
+
+template <Type ValType>
+struct SimdConvert
+{
+    using CppType = typename ResolveType<ValType>::type;
+
+    static CppType get(const sj::dom::element& json)
+    {
+        if constexpr (ValType == Type::String) {
+            return std::string(json.get_string().value());
+        } else if constexpr (ValType == Type::Bool) {
+            if (json.type() == sj::dom::element_type::STRING) {
+                return fty::convert<bool>(std::string(json.get_string().value()));
+            }
+            return json.get_bool().value();
+        } else {
+            return number<CppType>(json);
+        }
+    }
+
+    static void decode(Value<ValType>& node, const sj::dom::element& json)
+    {
+        if (!json.is_null()) {
+            node = get(json);
+        }
+    }
+
+    static void decode(ValueList<ValType>& node, const sj::dom::element& json)
+    {
+        if (json.is_null()) {
+            return;
+        }
+
+        if constexpr (ValType == Type::UChar) {
+            if (json.is_string()) {
+                node.setValue(base64::decode(json.get_string().value()));
+                return;
+            }
+        }
+
+        for (sj::dom::element it : json.get_array().value()) {
+            node.append(it.is_null() ? CppType{} : get(it));
+        }
+    }
+
+    static void decode(ValueMap<ValType>& node, const sj::dom::element& json)
+    {
+        for (sj::dom::key_value_pair it : json.get_object().value()) {
+            node.append(std::string(it.key), it.value.is_null() ? CppType{} : get(it.value));
+        }
+    }
+};
+
+// =========================================================================================================================================
+
+class SimdJsonDeserializer : public Deserialize<SimdJsonDeserializer>
+{
+public:
+    template <typename T>
+    static void unpackValue(T& val, const sj::dom::element& json)
+    {
+        SimdConvert<T::ThisType>::decode(val, json);
+    }
+
+    static void unpackValue(IEnum& en, const sj::dom::element& json)
+    {
+        en.fromString(std::string(json.get_string().value()));
+    }
+
+    static void unpackValue(IObjectMap& map, const sj::dom::element& json)
+    {
+        for (sj::dom::key_value_pair it : json.get_object().value()) {
+            auto& obj = map.create(std::string(it.key));
+            visit(obj, it.value);
+        }
+    }
+
+    static void unpackValue(IObjectList& list, const sj::dom::element& json)
+    {
+        for (sj::dom::element child : json.get_array().value()) {
+            auto& obj = list.create();
+            visit(obj, child);
+        }
+    }
+
+    static void unpackValue(INode& node, const sj::dom::element& json)
+    {
+        sj::dom::object obj;
+        if (json.get_object().get(obj) != sj::SUCCESS) {
+            return;
+        }
+
+        eachField(node, [&](Attribute& it) {
+            sj::dom::element child;
+            if (obj.at_key(it.key()).get(child) == sj::SUCCESS) {
+                visit(it, child);
+            }
+        });
+    }
+
+    static void unpackValue(IProtoMap& map, const sj::dom::element& json)
+    {
+        for (sj::dom::key_value_pair it : json.get_object().value()) {
+            auto [key, value] = map.createEntry();
+            keyFromString(key, std::string(it.key));
+            visit(value, it.value);
+        }
+    }
+
+    static void unpackValue(IVariant& var, const sj::dom::element& json)
+    {
+        std::vector<std::string> keys;
+        for (sj::dom::key_value_pair it : json.get_object().value()) {
+            keys.emplace_back(it.key);
+        }
+        if (var.findBetter(keys)) {
+            if (auto ptr = var.get()) {
+                unpackValue(static_cast<INode&>(*ptr), json);
+            }
+        }
+    }
+
+    static void unpackValue(ILazy& lazy, const sj::dom::element& json)
+    {
+        if (json.is_null()) {
+            lazy.clear();
+        } else {
+            lazy.setRaw(ILazy::Format::Json, sj::minify(json));
+        }
+    }
+};
+
+// =========================================================================================================================================
+
+fty::Expected<void> decode(std::string_view content, Attribute& node)
+{
+    // Parser keeps its buffers between the calls, so one per thread
+    thread_local sj::dom::parser parser;
+
+    try {
+        sj::dom::element json = parser.parse(content.data(), content.size()).value();
+        SimdJsonDeserializer::visit(node, json);
+        return {};
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+// =========================================================================================================================================
+
+} // namespace pack::json
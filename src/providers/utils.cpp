@@ -1,8 +1,72 @@
 #include "utils.h"
+#include "pack/pack.h"
+#include "pack/visitor.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 namespace pack {
 
+// =========================================================================================================================================
+
+class KeySerializer : public Serialize<KeySerializer>
+{
+public:
+    template <typename T>
+    static void packValue(const T& val, std::string& str, Option /*opt*/)
+    {
+        if constexpr (std::is_base_of_v<IValue, T>) {
+            str = fty::convert<std::string>(val.value());
+        } else {
+            throw std::runtime_error("Unsupported map key type");
+        }
+    }
+
+    static void packValue(const IEnum& en, std::string& str, Option /*opt*/)
+    {
+        str = en.asString();
+    }
+};
+
+class KeyDeserializer : public Deserialize<KeyDeserializer>
+{
+public:
+    template <typename T>
+    static void unpackValue(T& val, const std::string& str)
+    {
+        if constexpr (std::is_base_of_v<IValue, T>) {
+            val = fty::convert<typename T::CppType>(str);
+        } else {
+            throw std::runtime_error("Unsupported map key type");
+        }
+    }
+
+    static void unpackValue(IEnum& en, const std::string& str)
+    {
+        en.fromString(str);
+    }
+};
+
+std::string keyToString(const Attribute& key)
+{
+    std::string str;
+    KeySerializer::visit(key, str, Option::No);
+    return str;
+}
+
+void keyFromString(Attribute& key, const std::string& str)
+{
+    KeyDeserializer::visit(key, str);
+}
+
+// =========================================================================================================================================
+
 fty::Expected<std::string> read(const std::string& filename)
 {
     std::ifstream st(filename);
@@ -23,4 +87,155 @@ fty::Expected<void> write(const std::string& filename, const std::string& conten
     return fty::unexpected("Cannot read file {}", filename);
 }
 
+// =========================================================================================================================================
+
+/// Worker threads shared by all the parallel loops, started on the first use and kept till the process end, so the
+/// loops do not pay for the thread creation
+class WorkerPool
+{
+public:
+    static WorkerPool& instance()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    /// Count of the workers, the calling thread is not counted
+    size_t size() const
+    {
+        return m_threads.size();
+    }
+
+    void post(std::function<void()>&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_cond.notify_one();
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for (auto& it : m_threads) {
+            it.join();
+        }
+    }
+
+private:
+    WorkerPool()
+    {
+        size_t count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        m_threads.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            m_threads.emplace_back([this]() {
+                run();
+            });
+        }
+    }
+
+    void run()
+    {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cond.wait(lock, [&]() {
+                    return m_stop || !m_jobs.empty();
+                });
+                if (m_jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+private:
+    std::mutex                        m_mutex;
+    std::condition_variable           m_cond;
+    std::deque<std::function<void()>> m_jobs;
+    bool                              m_stop = false;
+    std::vector<std::thread>          m_threads;
+};
+
+fty::Expected<void> parallelFor(size_t count, size_t threads, const std::function<fty::Expected<void>(size_t)>& func)
+{
+    WorkerPool& pool = WorkerPool::instance();
+    if (threads == 0) {
+        threads = pool.size() + 1;
+    }
+    threads = std::min({threads, count, pool.size() + 1});
+
+    // Helpers could start after the loop is done (the pool is busy with other loops, nested ones too), then they just
+    // leave. The loop waits only for the helpers which have started, so it never waits for the busy pool.
+    struct State
+    {
+        std::mutex                              mutex;
+        std::condition_variable                 cond;
+        size_t                                  running = 0;
+        bool                                    done    = false;
+        std::atomic<size_t>                     next{0};
+        std::vector<std::optional<std::string>> errors;
+        const FieldMask*                        mask = nullptr;
+    };
+    auto state = std::make_shared<State>();
+    state->errors.resize(count);
+    state->mask = FieldMask::active();
+
+    // Elements are taken one by one, so slow ones do not hold the rest
+    auto worker = [&func, count](State& st) {
+        FieldMask::Scope scope(st.mask);
+        for (size_t i = st.next++; i < count; i = st.next++) {
+            try {
+                if (auto ret = func(i); !ret) {
+                    st.errors[i] = ret.error();
+                }
+            } catch (const std::exception& e) {
+                st.errors[i] = e.what();
+            }
+        }
+    };
+
+    for (size_t i = 0; i + 1 < threads; ++i) {
+        pool.post([state, worker]() {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->done) {
+                    return;
+                }
+                ++state->running;
+            }
+            worker(*state);
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                --state->running;
+            }
+            state->cond.notify_all();
+        });
+    }
+    worker(*state);
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cond.wait(lock, [&]() {
+            return state->running == 0;
+        });
+        state->done = true;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (state->errors[i]) {
+            return fty::unexpected("Element {}: {}", i, *state->errors[i]);
+        }
+    }
+    return {};
+}
+
 }
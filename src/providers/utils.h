@@ -1,9 +1,23 @@
 #pragma once
+#include <functional>
 #include <fty/expected.h>
 
 namespace pack {
 
+class Attribute;
+
 fty::Expected<std::string> read(const std::string& filename);
 fty::Expected<void>        write(const std::string& filename, const std::string& content);
 
+/// Returns map key (simple value or enum) as string, for the formats where keys are always strings
+std::string keyToString(const Attribute& key);
+
+/// Sets map key (simple value or enum) from its string form
+void keyFromString(Attribute& key, const std::string& str);
+
+/// Calls `func` for every index in [0, count) by `threads` workers (0 means hardware concurrency, it is the limit too),
+/// the calling thread and the threads of the shared pool. Active field mask is passed to the workers. Returns when all
+/// are done, with the error of the first failed index if any.
+fty::Expected<void> parallelFor(size_t count, size_t threads, const std::function<fty::Expected<void>(size_t)>& func);
+
 } // namespace pack
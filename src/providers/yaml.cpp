@@ -17,7 +17,9 @@
 #include "pack/pack.h"
 #include "pack/serialization.h"
 #include "pack/visitor.h"
+#include "base64.h"
 #include "utils.h"
+#include <fstream>
 #include <fty/flags.h>
 #include <yaml-cpp/yaml.h>
 
@@ -38,10 +40,7 @@ struct Convert
     static void decode(ValueList<ValType>& node, const YAML::Node& yaml)
     {
         if constexpr (ValType == Type::UChar) {
-            YAML::Binary         binary = yaml.as<YAML::Binary>();
-            const unsigned char* data   = binary.data();
-            std::size_t          size   = binary.size();
-            node.setValue({data, data + size});
+            node.setValue(base64::decode(yaml.Scalar()));
         } else {
             for (const auto& it : yaml) {
                 node.append(it.as<CppType>());
@@ -69,7 +68,7 @@ struct Convert
                     yaml.push_back(YAML::convert<CppType>::encode(it));
                 }
             } else if constexpr (ValType == Type::UChar) {
-                yaml = YAML::Binary(&node.value()[0], size_t(node.size()));
+                yaml = base64::encode(node.value().data(), node.value().size());
             } else {
                 for (const auto& it : node) {
                     yaml.push_back(YAML::convert<CppType>::encode(it));
@@ -127,24 +126,20 @@ public:
 
     static void unpackValue(INode& node, const YAML::Node& yaml)
     {
-        for (auto& it : node.fields()) {
-            auto found = yaml[it->key()];
+        eachField(node, [&](Attribute& it) {
+            auto found = yaml[it.key()];
             if (found.IsDefined()) {
-                visit(*it, found);
+                visit(it, found);
             }
-        }
+        });
     }
 
     static void unpackValue(IProtoMap& map, const YAML::Node& yaml)
     {
         for (const auto& child : yaml) {
-            INode& obj = map.create();
-
-            YAML::Node temp;
-            temp["key"]   = child.first;
-            temp["value"] = child.second;
-
-            visit(obj, temp);
+            auto [key, value] = map.createEntry();
+            keyFromString(key, child.first.as<std::string>());
+            visit(value, child.second);
         }
     }
 
@@ -160,6 +155,16 @@ public:
             }
         }
     }
+
+    static void unpackValue(ILazy& lazy, const YAML::Node& yaml)
+    {
+        if (yaml.IsNull()) {
+            lazy.clear();
+        } else {
+            // Yaml tree is built already, dump and parse back on access would cost more than decoding it now
+            visit(lazy.node(), yaml);
+        }
+    }
 };
 
 // =========================================================================================================================================
@@ -207,12 +212,12 @@ public:
 
     static void packValue(const INode& node, YAML::Node& yaml, Option opt)
     {
-        for (auto& it : node.fields()) {
+        eachField(node, [&](const Attribute& it) {
             if (node.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
-                YAML::Node child = yaml[it->key()];
-                visit(*it, child, opt);
+                YAML::Node child = yaml[it.key()];
+                visit(it, child, opt);
             }
-        }
+        });
     }
 
     static void packValue(const IEnum& en, YAML::Node& yaml, Option /*opt*/)
@@ -224,12 +229,8 @@ public:
     {
         if (map.size()) {
             for (int i = 0; i < map.size(); ++i) {
-                const INode& node = map.get(i);
-
-                YAML::Node temp;
-                packValue(node, temp, opt);
-
-                yaml[temp["key"]] = temp["value"];
+                YAML::Node child = yaml[keyToString(map.entryKey(i))];
+                visit(map.entryValue(i), child, opt);
             }
         } else if (fty::isSet(opt, Option::WithDefaults)) {
             yaml = YAML::Node(YAML::NodeType::Map);
@@ -242,16 +243,63 @@ public:
             packValue(static_cast<const INode&>(*ptr), yaml, opt);
         }
     }
+
+    static void packValue(const ILazy& lazy, YAML::Node& yaml, Option opt)
+    {
+        visit(lazy.node(), yaml, opt);
+    }
 };
 
 // =========================================================================================================================================
 
 fty::Expected<std::string> serialize(const Attribute& node, Option opt)
+{
+    std::string out;
+    if (auto ret = serialize(node, out, opt); !ret) {
+        return fty::unexpected(ret.error());
+    }
+    return out;
+}
+
+fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt)
+{
+    FieldMask::Scope scope(&mask);
+    return serialize(node, opt);
+}
+
+fty::Expected<void> serialize(const Attribute& node, std::string& out, Option opt)
 {
     try {
         YAML::Node yaml;
         YamlSerializer::visit(node, yaml, opt);
-        return YAML::Dump(yaml);
+
+        YAML::Emitter emitter;
+        emitter << yaml;
+        if (!emitter.good()) {
+            return fty::unexpected(emitter.GetLastError());
+        }
+        out.append(emitter.c_str(), emitter.size());
+        return {};
+    } catch (const std::exception& e) {
+        return fty::unexpected(e.what());
+    }
+}
+
+fty::Expected<void> serialize(const Attribute& node, std::ostream& out, Option opt)
+{
+    try {
+        YAML::Node yaml;
+        YamlSerializer::visit(node, yaml, opt);
+
+        YAML::Emitter emitter(out);
+        emitter << yaml;
+        if (!emitter.good()) {
+            return fty::unexpected(emitter.GetLastError());
+        }
+        if (!out) {
+            return fty::unexpected("Cannot write to the stream");
+        }
+        return {};
     } catch (const std::exception& e) {
         return fty::unexpected(e.what());
     }
@@ -268,6 +316,12 @@ fty::Expected<void> deserialize(const std::string& content, Attribute& node)
     }
 }
 
+fty::Expected<void> deserialize(const std::string& content, Attribute& node, const FieldMask& mask)
+{
+    FieldMask::Scope scope(&mask);
+    return deserialize(content, node);
+}
+
 fty::Expected<void> deserializeFile(const std::string& fileName, Attribute& node)
 {
     if (auto cnt = read(fileName)) {
@@ -279,14 +333,11 @@ fty::Expected<void> deserializeFile(const std::string& fileName, Attribute& node
 
 fty::Expected<void> serializeFile(const std::string& fileName, const Attribute& node, Option opt)
 {
-    if (auto ret = serialize(node, opt)) {
-        if (auto res = write(fileName, *ret); !res) {
-            return fty::unexpected(res.error());
-        }
-        return {};
-    } else {
-        return fty::unexpected(ret.error());
+    std::ofstream st(fileName);
+    if (!st.is_open()) {
+        return fty::unexpected("Cannot write file {}", fileName);
     }
+    return serialize(node, st, opt);
 }
 
 // =========================================================================================================================================
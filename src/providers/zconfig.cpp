@@ -16,11 +16,13 @@
 
 #include "pack/pack.h"
 #include "pack/visitor.h"
+#include "base64.h"
+#include "utils.h"
 #include <cassert>
 #include <czmq.h>
 #include <fty/convert.h>
 #include <memory>
-#include <yaml-cpp/yaml.h>
+#include <ostream>
 #include <zconfig.h>
 
 namespace pack {
@@ -40,7 +42,7 @@ struct Convert
     static void decode(ValueList<ValType>& node, zconfig_t* zconf)
     {
         if constexpr (ValType == Type::UChar) {
-            node.setValue(typename ValueList<ValType>::ListType(YAML::DecodeBase64(zconfig_value(zconf))));
+            node.setValue(base64::decode(zconfig_value(zconf)));
         } else {
             for (zconfig_t* item = zconfig_child(zconf); item; item = zconfig_next(item)) {
                 node.append(fty::convert<CppType>(zconfig_value(item)));
@@ -69,7 +71,7 @@ struct Convert
                 zconfig_set_value(child, "%s", fty::convert<std::string>(it).c_str());
             }
         } else if constexpr (ValType == Type::UChar) {
-            zconfig_set_value(zconf, "%s", YAML::EncodeBase64(node.value().data(), size_t(node.size())).c_str());
+            zconfig_set_value(zconf, "%s", base64::encode(node.value().data(), node.value().size()).c_str());
         } else {
             for (const auto& it : node) {
                 auto child = zconfig_new(fty::convert<std::string>(i++).c_str(), zconf);
@@ -87,18 +89,6 @@ struct Convert
     }
 };
 
-static void copy(zconfig_t* dest, zconfig_t* src)
-{
-    for (zconfig_t* item = zconfig_child(src); item; item = zconfig_next(item)) {
-        auto child = zconfig_new(zconfig_name(item), dest);
-        if (zconfig_value(item)) {
-            zconfig_set_value(child, "%s", zconfig_value(item));
-        } else if (zconfig_child(child)) {
-            copy(child, item);
-        }
-    }
-}
-
 // =========================================================================================================================================
 
 class ZSerializer : public Serialize<ZSerializer>
@@ -127,12 +117,12 @@ public:
 
     static void packValue(const INode& node, zconfig_t* zconf, Option opt)
     {
-        for (auto& it : node.fields()) {
-            if (it->hasValue() || fty::isSet(opt, Option::WithDefaults)) {
-                auto child = zconfig_new(it->key().c_str(), zconf);
-                visit(*it, child, opt);
+        eachField(node, [&](const Attribute& it) {
+            if (it.hasValue() || fty::isSet(opt, Option::WithDefaults)) {
+                auto child = zconfig_new(it.key().c_str(), zconf);
+                visit(it, child, opt);
             }
-        }
+        });
     }
 
     static void packValue(const IEnum& en, zconfig_t* zconf, Option /*opt*/)
@@ -143,28 +133,19 @@ public:
     static void packValue(const IProtoMap& map, zconfig_t* zconf, Option opt)
     {
         for (int i = 0; i < map.size(); ++i) {
-            const INode& node = map.get(i);
-
-            auto temp = zconfig_new("", nullptr);
-            packValue(node, temp, opt);
-
-            auto zkey = zconfig_locate(temp, "key");
-            auto zval = zconfig_locate(temp, "value");
-
-            auto child = zconfig_new(zconfig_value(zkey), zconf);
-            if (zconfig_child(zval)) {
-                copy(child, zval);
-            } else {
-                zconfig_set_value(child, "%s", zconfig_value(zval));
-            }
-
-            zconfig_destroy(&temp);
+            auto child = zconfig_new(keyToString(map.entryKey(i)).c_str(), zconf);
+            visit(map.entryValue(i), child, opt);
         }
     }
 
     static void packValue(const IVariant& /*val*/, zconfig_t* /*zconf*/, Option /*opt*/)
     {
     }
+
+    static void packValue(const ILazy& lazy, zconfig_t* zconf, Option opt)
+    {
+        visit(lazy.node(), zconf, opt);
+    }
 };
 
 // =========================================================================================================================================
@@ -201,38 +182,31 @@ public:
 
     static void unpackValue(INode& node, zconfig_t* conf)
     {
-        for (auto& it : node.fields()) {
-            if (auto found = zconfig_locate(conf, it->key().c_str())) {
-                visit(*it, found);
+        eachField(node, [&](Attribute& it) {
+            if (auto found = zconfig_locate(conf, it.key().c_str())) {
+                visit(it, found);
             }
-        }
+        });
     }
 
     static void unpackValue(IProtoMap& map, zconfig_t* conf)
     {
         for (zconfig_t* item = zconfig_child(conf); item; item = zconfig_next(item)) {
-            INode& obj = map.create();
-
-            auto temp = zconfig_new(nullptr, nullptr);
-            auto zkey = zconfig_new("key", temp);
-            zconfig_set_value(zkey, "%s", zconfig_name(item));
-            auto zval = zconfig_new("value", temp);
-
-            if (zconfig_child(item)) {
-                copy(zval, item);
-            } else {
-                zconfig_set_value(zval, "%s", zconfig_value(item));
-            }
-
-            visit(obj, temp);
-
-            zconfig_destroy(&temp);
+            auto [key, value] = map.createEntry();
+            keyFromString(key, zconfig_name(item));
+            visit(value, item);
         }
     }
 
     static void unpackValue(IVariant& /*var*/, zconfig_t* /*conf*/)
     {
     }
+
+    static void unpackValue(ILazy& lazy, zconfig_t* conf)
+    {
+        // No raw form for zconfig subtree, decoded immediately
+        visit(lazy.node(), conf);
+    }
 };
 
 // =========================================================================================================================================
@@ -240,15 +214,50 @@ public:
 namespace zconfig {
     fty::Expected<std::string> serialize(const Attribute& node, Option opt)
     {
+        std::string out;
+        if (auto ret = serialize(node, out, opt); !ret) {
+            return fty::unexpected(ret.error());
+        }
+        return out;
+    }
+
+    fty::Expected<std::string> serialize(const Attribute& node, const FieldMask& mask, Option opt)
+    {
+        FieldMask::Scope scope(&mask);
+        return serialize(node, opt);
+    }
+
+    fty::Expected<void> serialize(const Attribute& node, std::string& out, Option opt)
+    {
+        zconfig_t* config = zconfig_new("root", nullptr);
         try {
-            zconfig_t* config = zconfig_new("root", nullptr);
             ZSerializer::visit(node, config, opt);
-            auto        zret = zconfig_str_save(config);
-            std::string ret(zret);
+            auto zret = zconfig_str_save(config);
+            out.append(zret);
             zstr_free(&zret);
             zconfig_destroy(&config);
-            return std::move(ret);
+            return {};
         } catch (const std::exception& e) {
+            zconfig_destroy(&config);
+            return fty::unexpected(e.what());
+        }
+    }
+
+    fty::Expected<void> serialize(const Attribute& node, std::ostream& out, Option opt)
+    {
+        zconfig_t* config = zconfig_new("root", nullptr);
+        try {
+            ZSerializer::visit(node, config, opt);
+            auto zret = zconfig_str_save(config);
+            out << zret;
+            zstr_free(&zret);
+            zconfig_destroy(&config);
+            if (!out) {
+                return fty::unexpected("Cannot write to the stream");
+            }
+            return {};
+        } catch (const std::exception& e) {
+            zconfig_destroy(&config);
             return fty::unexpected(e.what());
         }
     }
@@ -264,6 +273,12 @@ namespace zconfig {
             return fty::unexpected(e.what());
         }
     }
+
+    fty::Expected<void> deserialize(const std::string& content, Attribute& node, const FieldMask& mask)
+    {
+        FieldMask::Scope scope(&mask);
+        return deserialize(content, node);
+    }
 } // namespace zconfig
 
 // =========================================================================================================================================
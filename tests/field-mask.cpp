@@ -0,0 +1,175 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+#include "examples/example2.h"
+#include "examples/example3.h"
+#include <catch2/catch.hpp>
+#include <pack/pack.h>
+
+struct Dashboard : public pack::Node
+{
+    struct Metric : public pack::Node
+    {
+        pack::String name = FIELD("name");
+        pack::Double load = FIELD("load");
+        pack::Int64  time = FIELD("time");
+
+        using pack::Node::Node;
+        META(Metric, name, load, time);
+    };
+
+    pack::String             id      = FIELD("id");
+    pack::String             status  = FIELD("status");
+    Metric                   current = FIELD("current");
+    pack::ObjectList<Metric> metrics = FIELD("metrics");
+    pack::Map<Metric>        byName  = FIELD("byName");
+
+    using pack::Node::Node;
+    META(Dashboard, id, status, current, metrics, byName);
+};
+
+TEST_CASE("Field mask")
+{
+    Dashboard data;
+    data.id             = "id";
+    data.status         = "ok";
+    data.current.name   = "cpu";
+    data.current.load   = 0.5;
+    data.current.time   = 42;
+    auto& metric        = data.metrics.append();
+    metric.name         = "mem";
+    metric.load         = 0.25;
+    metric.time         = 43;
+    data.byName.append("mem", metric);
+
+    SECTION("Json")
+    {
+        CHECK(*pack::json::serialize(data, pack::FieldMask{"status"}) == R"({"status":"ok"})");
+        CHECK(*pack::json::serialize(data, {"status", "current.load"}) == R"({"status":"ok","current":{"load":0.5}})");
+        CHECK(*pack::json::serialize(data, {"metrics.load", "byName.name"}) ==
+              R"({"metrics":[{"load":0.25}],"byName":{"mem":{"name":"mem"}}})");
+        CHECK(*pack::json::serialize(data, {"current", "current.load"}) ==
+              R"({"current":{"name":"cpu","load":0.5,"time":42}})");
+        CHECK(*pack::json::serialize(data, {"unknown"}) == R"({})");
+        CHECK(*pack::json::serialize(data, pack::FieldMask{}) == *pack::json::serialize(data));
+    }
+
+    SECTION("Mask is compiled once and reused")
+    {
+        pack::FieldMask mask{"id", "metrics.name"};
+        CHECK(*pack::json::serialize(data, mask) == R"({"id":"id","metrics":[{"name":"mem"}]})");
+        CHECK(*pack::json::serialize(data, mask) == R"({"id":"id","metrics":[{"name":"mem"}]})");
+        CHECK(pack::FieldMask::active() == nullptr);
+
+        // Mask of the list applies to the elements
+        CHECK(*pack::json::serialize(data.metrics, {"name"}) == R"([{"name":"mem"}])");
+    }
+
+    SECTION("Yaml")
+    {
+        Dashboard restored;
+        REQUIRE(pack::yaml::deserialize(*pack::yaml::serialize(data, {"status", "metrics.time"}), restored));
+        CHECK(restored.status == "ok");
+        CHECK(restored.id == "");
+        CHECK(!restored.current.hasValue());
+        REQUIRE(restored.metrics.size() == 1);
+        CHECK(restored.metrics[0].time == 43);
+        CHECK(restored.metrics[0].name == "");
+    }
+
+    SECTION("Protobuf")
+    {
+        test3::Item item;
+        item.name       = "name";
+        item.sub.name   = "sub";
+        item.sub.exists = true;
+
+        test3::Item restored;
+        REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(item, {"sub.exists"}), restored));
+        CHECK(restored.name == "");
+        CHECK(restored.sub.name == "");
+        CHECK(restored.sub.exists == true);
+
+        test::Person2 person;
+        person.name  = "person";
+        person.value = 42;
+        person.items.append(1);
+        person.more.append().name = "more";
+
+        test::Person2 restoredPerson;
+        REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(person, {"value", "more"}), restoredPerson));
+        CHECK(restoredPerson.name == "");
+        CHECK(restoredPerson.items.size() == 0);
+        CHECK(restoredPerson.value == 42);
+        CHECK(restoredPerson.more.size() == 1);
+    }
+}
+
+TEST_CASE("Field mask deserialization")
+{
+    // Unrequested content is broken on purpose: it is skipped, so it must not fail
+    std::string json = R"({
+        "id": "id",
+        "status": "ok",
+        "current": {"name": "cpu", "load": {"broken": true}},
+        "metrics": [{"name": "mem", "load": 0.25, "time": [1, 2]}, {"name": "disk", "load": 0.5}],
+        "byName": {"mem": {"name": "mem", "load": 0.25}}
+    })";
+
+    SECTION("Json")
+    {
+        Dashboard data;
+        REQUIRE(pack::json::deserialize(json, data, {"status", "current.name", "metrics.load", "byName.load"}));
+        CHECK(data.id == "");
+        CHECK(data.status == "ok");
+        CHECK(data.current.name == "cpu");
+        CHECK(!data.current.load.hasValue());
+        REQUIRE(data.metrics.size() == 2);
+        CHECK(data.metrics[0].name == "");
+        CHECK(data.metrics[0].load == 0.25);
+        CHECK(data.metrics[1].load == 0.5);
+        REQUIRE(data.byName.size() == 1);
+        CHECK(data.byName["mem"].name == "");
+        CHECK(data.byName["mem"].load == 0.25);
+
+        Dashboard full;
+        CHECK(!pack::json::deserialize(json, full));
+    }
+
+    SECTION("Yaml")
+    {
+        Dashboard data;
+        REQUIRE(pack::yaml::deserialize(json, data, {"id", "metrics.name"}));
+        CHECK(data.id == "id");
+        CHECK(data.status == "");
+        REQUIRE(data.metrics.size() == 2);
+        CHECK(data.metrics[1].name == "disk");
+        CHECK(!data.metrics[1].load.hasValue());
+    }
+
+    SECTION("Protobuf")
+    {
+        test::Person2 person;
+        person.name  = "person";
+        person.value = 42;
+        person.items.append(1);
+
+        test::Person2 restored;
+        REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(person), restored, {"value"}));
+        CHECK(restored.name == "");
+        CHECK(restored.items.size() == 0);
+        CHECK(restored.value == 42);
+    }
+}
@@ -0,0 +1,119 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+
+#include <catch2/catch.hpp>
+#include <pack/pack.h>
+#include <unordered_set>
+
+struct Sensor : public pack::Node
+{
+    struct Reading : public pack::Node
+    {
+        pack::String name  = FIELD("name");
+        pack::Double value = FIELD("value");
+
+        using pack::Node::Node;
+        META(Reading, name, value);
+    };
+
+    pack::String              id       = FIELD("id");
+    pack::Int32               status   = FIELD("status");
+    pack::StringList          tags     = FIELD("tags");
+    pack::Binary              raw      = FIELD("raw");
+    Reading                   last     = FIELD("last");
+    pack::ObjectList<Reading> readings = FIELD("readings");
+    pack::Int32Map            counts   = FIELD("counts");
+
+    using pack::Node::Node;
+    META(Sensor, id, status, tags, raw, last, readings, counts);
+};
+
+TEST_CASE("Fingerprint")
+{
+    Sensor sensor;
+    sensor.id     = "sensor";
+    sensor.status = 1;
+    sensor.tags.setValue({"a", "b"});
+    sensor.raw.setValue({1, 2, 3});
+    sensor.last.name  = "temp";
+    sensor.last.value = 21.5;
+    auto& reading     = sensor.readings.append();
+    reading.name      = "hum";
+    reading.value     = 40;
+    sensor.counts.append("ok", 3);
+
+    SECTION("Equal nodes")
+    {
+        Sensor copy = sensor;
+        CHECK(pack::fingerprint(copy) == pack::fingerprint(sensor));
+
+        Sensor restored;
+        REQUIRE(pack::json::deserialize(*pack::json::serialize(sensor), restored));
+        CHECK(pack::fingerprint(restored) == pack::fingerprint(sensor));
+
+        // Field mask for serialization does not matter
+        auto                   whole = pack::fingerprint(sensor);
+        pack::FieldMask        mask{"id"};
+        pack::FieldMask::Scope scope(&mask);
+        CHECK(pack::fingerprint(sensor) == whole);
+
+        CHECK(pack::fingerprint(Sensor()) == pack::fingerprint(Sensor()));
+    }
+
+    SECTION("Changes")
+    {
+        auto orig = pack::fingerprint(sensor);
+
+        Sensor copy = sensor;
+        copy.status = 2;
+        CHECK(pack::fingerprint(copy) != orig);
+
+        copy = sensor;
+        copy.tags.setValue({"ab"});
+        CHECK(pack::fingerprint(copy) != orig);
+
+        copy = sensor;
+        copy.raw.setValue({1, 2, 4});
+        CHECK(pack::fingerprint(copy) != orig);
+
+        copy = sensor;
+        copy.readings[0].value = 41;
+        CHECK(pack::fingerprint(copy) != orig);
+
+        copy = sensor;
+        copy.counts.append("fail", 0);
+        CHECK(pack::fingerprint(copy) != orig);
+
+        copy = sensor;
+        copy.last.clear();
+        CHECK(pack::fingerprint(copy) != orig);
+    }
+
+    SECTION("Unordered containers")
+    {
+        Sensor other = sensor;
+        other.id     = "other";
+
+        std::unordered_set<Sensor, pack::Hash> set;
+        set.insert(sensor);
+        set.insert(other);
+        set.insert(Sensor(sensor));
+        CHECK(set.size() == 2);
+        CHECK(set.count(other) == 1);
+
+        CHECK(std::hash<pack::Attribute>()(sensor) == pack::fingerprint(sensor));
+    }
+}
@@ -16,6 +16,7 @@
 #include <catch2/catch.hpp>
 #include <iostream>
 #include <pack/pack.h>
+#include <sstream>
 
 struct Empty : public pack::Node
 {
@@ -77,3 +78,423 @@ TEST_CASE("Orderding data in json")
     auto json = *pack::json::serialize(data);
     CHECK(json == R"({"c":"C","a":"A"})"); // Ordered as in pack structure and without default value
 }
+
+TEST_CASE("Json lines")
+{
+    pack::ObjectList<MyData> list;
+    for (int i = 0; i < 5; ++i) {
+        auto& it = list.append();
+        it.a     = "a" + std::to_string(i);
+        it.c     = "c" + std::to_string(i);
+    }
+
+    std::stringstream ss;
+    REQUIRE(pack::json::serializeLines(ss, list));
+    CHECK(ss.str().substr(0, 40) == "{\"c\":\"c0\",\"a\":\"a0\"}\n{\"c\":\"c1\",\"a\":\"a1\"}\n");
+
+    SECTION("Element by element")
+    {
+        std::stringstream in(ss.str());
+        int               count = 0;
+        auto              ret   = pack::json::deserializeLines<MyData>(in, [&](const MyData& item) {
+            CHECK(item == list[count]);
+            ++count;
+        });
+        REQUIRE(ret);
+        CHECK(count == 5);
+    }
+
+    SECTION("Batches")
+    {
+        std::stringstream        in(ss.str());
+        pack::ObjectList<MyData> batch;
+        std::vector<int>         sizes;
+        auto                     ret = pack::json::deserializeLines(in, batch, 2, [&](pack::IObjectList& items) {
+            sizes.push_back(items.size());
+        });
+        REQUIRE(ret);
+        CHECK(sizes == std::vector<int>{2, 2, 1});
+
+        std::stringstream again(ss.str());
+        CHECK(!pack::json::deserializeLines(again, batch, 0, [](pack::IObjectList&) {}));
+    }
+
+    SECTION("Broken line")
+    {
+        std::stringstream in("{\"a\":\"A\"}\n\n{\"a\":\n");
+        int               count = 0;
+        auto              ret   = pack::json::deserializeLines<MyData>(in, [&](const MyData&) {
+            ++count;
+        });
+        CHECK(!ret);
+        CHECK(ret.error().find("Line 3") == 0);
+        CHECK(count == 1);
+    }
+}
+
+TEST_CASE("Serialize into buffer")
+{
+    MyData data;
+    data.a = "A";
+    data.c = "C";
+
+    SECTION("Append to string")
+    {
+        std::string buf = "prefix:";
+        REQUIRE(pack::json::serialize(data, buf));
+        CHECK(buf == R"(prefix:{"c":"C","a":"A"})");
+
+        buf.clear();
+        REQUIRE(pack::yaml::serialize(data, buf));
+        CHECK(buf == *pack::yaml::serialize(data));
+    }
+
+    SECTION("Stream")
+    {
+        std::stringstream ss;
+        REQUIRE(pack::json::serialize(data, ss, pack::Option::PrettyPrint));
+        CHECK(ss.str() == *pack::json::serialize(data, pack::Option::PrettyPrint));
+
+        std::stringstream yml;
+        REQUIRE(pack::yaml::serialize(data, yml));
+        CHECK(yml.str() == *pack::yaml::serialize(data));
+    }
+}
+
+struct Blob : public pack::Node
+{
+    pack::Binary data = FIELD("data");
+
+    using pack::Node::Node;
+    META(Blob, data);
+};
+
+TEST_CASE("Binary as base64")
+{
+    auto bytes = [](const std::string& str) {
+        return std::vector<unsigned char>(str.begin(), str.end());
+    };
+
+    SECTION("Encoding")
+    {
+        Blob blob;
+        blob.data.setValue(bytes("Man"));
+        CHECK(*pack::json::serialize(blob, pack::Option::BinaryAsBase64) == R"({"data":"TWFu"})");
+        CHECK(*pack::json::serialize(blob) == R"({"data":[77,97,110]})");
+
+        blob.data.setValue(bytes("foob"));
+        CHECK(*pack::json::serialize(blob, pack::Option::BinaryAsBase64) == R"({"data":"Zm9vYg=="})");
+        blob.data.setValue(bytes("fooba"));
+        CHECK(*pack::json::serialize(blob, pack::Option::BinaryAsBase64) == R"({"data":"Zm9vYmE="})");
+    }
+
+    SECTION("Decoding both forms")
+    {
+        Blob blob;
+        REQUIRE(pack::json::deserialize(R"({"data":"Zm9vYmFy"})", blob));
+        CHECK(blob.data.value() == bytes("foobar"));
+
+        Blob arr;
+        REQUIRE(pack::json::deserialize(R"({"data":[102,111,111]})", arr));
+        CHECK(arr.data.value() == bytes("foo"));
+
+        Blob wrong;
+        CHECK(!pack::json::deserialize(R"({"data":"Zm9v!mFy"})", wrong));
+        CHECK(!pack::json::deserialize(R"({"data":"Zm9vYmF"})", wrong));
+    }
+
+    SECTION("Round trip")
+    {
+        // Long enough to pass the vectorized part and all the tail sizes
+        for (size_t size : {0, 1, 2, 3, 11, 12, 13, 16, 17, 24, 47, 48, 49, 100, 4099}) {
+            Blob blob;
+            std::vector<unsigned char> data(size);
+            for (size_t i = 0; i < size; ++i) {
+                data[i] = static_cast<unsigned char>(i * 7 + 3);
+            }
+            blob.data.setValue(data);
+
+            Blob restored;
+            REQUIRE(pack::json::deserialize(*pack::json::serialize(blob, pack::Option::BinaryAsBase64), restored));
+            CHECK(restored.data.value() == data);
+
+            Blob fromYaml;
+            REQUIRE(pack::yaml::deserialize(*pack::yaml::serialize(blob), fromYaml));
+            CHECK(fromYaml.data.value() == data);
+        }
+    }
+}
+
+struct Sized : public pack::Node
+{
+    enum class Kind
+    {
+        Unknown,
+        Some
+    };
+
+    struct Item : public pack::Node
+    {
+        pack::String name  = FIELD("name");
+        pack::Double value = FIELD("value");
+
+        using pack::Node::Node;
+        META(Item, name, value);
+    };
+
+    pack::String            text    = FIELD("text");
+    pack::Int64             number  = FIELD("number");
+    pack::UInt64            big     = FIELD("big");
+    pack::Float             ratio   = FIELD("ratio");
+    pack::Bool              flag    = FIELD("flag");
+    pack::Enum<Kind>        kind    = FIELD("kind");
+    pack::StringList        tags    = FIELD("tags");
+    pack::Int32List         numbers = FIELD("numbers");
+    pack::BoolList          flags   = FIELD("flags");
+    pack::Binary            data    = FIELD("data");
+    pack::DoubleMap         weights = FIELD("weights");
+    Item                    item    = FIELD("item");
+    pack::ObjectList<Item>  items   = FIELD("items");
+    pack::Map<Item>         byName  = FIELD("byName");
+    pack::ObjectList<Item>  empty   = FIELD("empty");
+
+    using pack::Node::Node;
+    META(Sized, text, number, big, ratio, flag, kind, tags, numbers, flags, data, weights, item, items, byName, empty);
+};
+
+TEST_CASE("Serialized size")
+{
+    auto check = [](const pack::Attribute& node) {
+        for (auto opt : {pack::Option::No, pack::Option::WithDefaults, pack::Option::ValueAsString, pack::Option::PrettyPrint,
+                 pack::Option::WithDefaults | pack::Option::PrettyPrint, pack::Option::BinaryAsBase64 | pack::Option::PrettyPrint}) {
+            auto size = pack::json::serializedSize(node, opt);
+            REQUIRE(size);
+            CHECK(*size == pack::json::serialize(node, opt)->size());
+        }
+    };
+
+    Sized empty;
+    check(empty);
+
+    Sized data;
+    data.text   = "quotes \" backslash \\ new line \n tab \t control \x01 utf-8 \xc5\xbe";
+    data.number = -1234567890123;
+    data.big    = 18446744073709551615ULL;
+    data.ratio  = 0.1f;
+    data.flag   = true;
+    data.kind   = Sized::Kind::Some;
+    data.tags.setValue({"a", "", "c\"d"});
+    data.numbers.setValue({0, -1, 10, 2147483647});
+    data.flags.setValue({true, false});
+    data.data.setValue({0, 1, 255, 16});
+    data.weights.append("w", 1e-7);
+    data.weights.append("inf", std::numeric_limits<double>::infinity());
+    data.item.name   = "item";
+    data.item.value  = 3.0;
+    auto& item       = data.items.append();
+    item.name        = "first";
+    data.byName.append("first", item);
+    data.items.append();
+    check(data);
+    check(data.items);
+    check(data.text);
+}
+
+TEST_CASE("Batch serialization")
+{
+    pack::ObjectList<MyData> list;
+    for (int i = 0; i < 10; ++i) {
+        auto& item = list.append();
+        item.a     = "a" + std::to_string(i);
+        item.c     = "c";
+    }
+
+    SECTION("Object list")
+    {
+        pack::Batch batch;
+        REQUIRE(pack::json::serialize(list, batch));
+        REQUIRE(batch.size() == 10);
+        for (int i = 0; i < list.size(); ++i) {
+            CHECK(batch[size_t(i)] == *pack::json::serialize(list[i]));
+        }
+        CHECK(batch.buffer.size() == batch.slices.back().offset + batch.slices.back().size);
+    }
+
+    SECTION("Nodes, appended")
+    {
+        pack::Batch batch;
+        REQUIRE(pack::json::serialize({&list[0], &list[1]}, batch, pack::Option::PrettyPrint));
+        REQUIRE(pack::json::serialize({&list[2]}, batch));
+        REQUIRE(batch.size() == 3);
+        CHECK(batch[1] == *pack::json::serialize(list[1], pack::Option::PrettyPrint));
+        CHECK(batch[2] == *pack::json::serialize(list[2]));
+
+        // Failed batch leaves content as it was
+        CHECK(!pack::json::serialize({&list[3], nullptr}, batch));
+        CHECK(batch.size() == 3);
+        CHECK(batch.buffer.size() == batch.slices.back().offset + batch.slices.back().size);
+
+        batch.clear();
+        CHECK(batch.size() == 0);
+    }
+}
+
+TEST_CASE("Parallel deserialization")
+{
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 100; ++i) {
+        MyData item;
+        item.a = "a" + std::to_string(i);
+        payloads.push_back(*pack::json::serialize(item));
+    }
+    std::vector<std::string_view> views(payloads.begin(), payloads.end());
+
+    std::vector<MyData>           items(payloads.size());
+    std::vector<pack::Attribute*> nodes;
+    for (auto& it : items) {
+        nodes.push_back(&it);
+    }
+
+    SECTION("All")
+    {
+        REQUIRE(pack::json::deserializeMany(views, nodes, 4));
+        for (size_t i = 0; i < items.size(); ++i) {
+            CHECK(items[i].a == "a" + std::to_string(i));
+        }
+    }
+
+    SECTION("Errors")
+    {
+        views[42] = "{";
+        auto ret  = pack::json::deserializeMany(views, nodes);
+        REQUIRE(!ret);
+        CHECK(ret.error().find("Element 42") == 0);
+        CHECK(items[41].a == "a41");
+
+        nodes.pop_back();
+        CHECK(!pack::json::deserializeMany(views, nodes));
+    }
+}
+
+TEST_CASE("Large lists")
+{
+    pack::ObjectList<Sized> list;
+    for (int i = 0; i < 5000; ++i) {
+        auto& item     = list.append();
+        item.text      = "item \"" + std::to_string(i) + "\" [{,}]";
+        item.number    = i;
+        item.item.name = "nested";
+        if (i % 3) {
+            item.tags.setValue({"a", "b]"});
+            item.items.append().value = i;
+        }
+    }
+
+    // Reference: elements one by one in a single element list, joined without brackets
+    auto reference = [&](pack::Option opt) {
+        bool        pretty = fty::isSet(opt, pack::Option::PrettyPrint);
+        size_t      skip   = pretty ? 2 : 1;
+        std::string all    = pretty ? "[\n" : "[";
+
+        pack::ObjectList<Sized> one;
+        one.append();
+        for (int i = 0; i < list.size(); ++i) {
+            one[0]              = list[i];
+            std::string content = *pack::json::serialize(one, opt);
+            if (i) {
+                all += pretty ? ",\n" : ",";
+            }
+            all += content.substr(skip, content.size() - 2 * skip);
+        }
+        return all + (pretty ? "\n]" : "]");
+    };
+
+    for (auto opt : {pack::Option::No, pack::Option::PrettyPrint}) {
+        std::string content = *pack::json::serialize(list, opt);
+        CHECK(content == reference(opt));
+
+        std::stringstream ss;
+        REQUIRE(pack::json::serialize(list, ss, opt));
+        CHECK(ss.str() == content);
+
+        pack::ObjectList<Sized> restored;
+        REQUIRE(pack::json::deserialize(content, restored));
+        REQUIRE(restored.size() == list.size());
+        CHECK(restored == list);
+    }
+
+    SECTION("Broken element")
+    {
+        std::string content = *pack::json::serialize(list);
+        content.replace(content.find("\"number\":4000"), 13, "\"number\":{}");
+
+        pack::ObjectList<Sized> restored;
+        auto                    ret = pack::json::deserialize(content, restored);
+        REQUIRE(!ret);
+        CHECK(ret.error().find("Element 4000") == 0);
+
+        CHECK(!pack::json::deserialize(content.substr(0, content.size() - 1), restored));
+    }
+}
+
+struct CanonicalDoc : public pack::Node
+{
+    pack::Double             zero    = FIELD("zero");
+    pack::Float              ratio   = FIELD("ratio");
+    pack::Double             whole   = FIELD("whole");
+    pack::Int32Map           counts  = FIELD("counts");
+    pack::Map<MyData>        objects = FIELD("objects");
+    pack::ObjectList<MyData> list    = FIELD("list");
+
+    using pack::Node::Node;
+    META(CanonicalDoc, zero, ratio, whole, counts, objects, list);
+};
+
+TEST_CASE("Canonical json")
+{
+    CanonicalDoc first;
+    first.zero  = -0.0;
+    first.ratio = 0.5f;
+    first.whole = 3.0;
+    first.counts.append("b", 2);
+    first.counts.append("a", 1);
+    MyData data;
+    data.a = "a";
+    data.c = "c";
+    first.objects.append("y", data);
+    first.objects.append("x", data);
+    first.list.append(data);
+
+    CanonicalDoc second = first;
+    second.counts.clear();
+    second.counts.append("a", 1);
+    second.counts.append("b", 2);
+    second.objects.clear();
+    second.objects.append("x", data);
+    second.objects.append("y", data);
+
+    CHECK(*pack::json::serialize(first) != *pack::json::serialize(second));
+
+    std::string canonical = *pack::json::serialize(first, pack::Option::Canonical);
+    CHECK(canonical == *pack::json::serialize(second, pack::Option::Canonical));
+    CHECK(canonical ==
+          R"({"counts":{"a":1,"b":2},"list":[{"a":"a","c":"c"}],"objects":{"x":{"a":"a","c":"c"},"y":{"a":"a","c":"c"}},)"
+          R"("ratio":0.5,"whole":3})");
+
+    for (auto opt : {pack::Option::Canonical, pack::Option::Canonical | pack::Option::PrettyPrint,
+             pack::Option::Canonical | pack::Option::WithDefaults}) {
+        CHECK(*pack::json::serializedSize(first, opt) == pack::json::serialize(first, opt)->size());
+    }
+
+    // Negative zero is written as integral zero, without sign
+    std::string withDefaults = *pack::json::serialize(first, pack::Option::Canonical | pack::Option::WithDefaults);
+    CHECK(withDefaults ==
+          R"({"counts":{"a":1,"b":2},"list":[{"a":"a","b":"","c":"c"}],"objects":{"x":{"a":"a","b":"","c":"c"},)"
+          R"("y":{"a":"a","b":"","c":"c"}},"ratio":0.5,"whole":3,"zero":0})");
+    CHECK(withDefaults.find(R"("zero":0})") != std::string::npos);
+    CHECK(withDefaults.find("-0") == std::string::npos);
+
+    CanonicalDoc restored;
+    REQUIRE(pack::json::deserialize(canonical, restored));
+    CHECK(*pack::json::serialize(restored, pack::Option::Canonical) == canonical);
+}
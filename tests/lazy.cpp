@@ -0,0 +1,202 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+#include "examples/example3.h"
+#include <catch2/catch.hpp>
+#include <sstream>
+
+struct Routed : public pack::Node
+{
+    struct Payload : public pack::Node
+    {
+        pack::String    name   = FIELD("name");
+        pack::Int32List values = FIELD("values");
+
+        using pack::Node::Node;
+        META(Payload, name, values);
+    };
+
+    pack::String        to      = FIELD("to");
+    pack::Lazy<Payload> payload = FIELD("payload");
+
+    using pack::Node::Node;
+    META(Routed, to, payload);
+};
+
+/// Same layout as test3::Item, but with lazy sub item
+struct LazyItem : public pack::Node
+{
+    pack::String                     name = FIELD("name");
+    pack::Lazy<test3::Item::SubItem> sub  = FIELD("sub");
+
+    using pack::Node::Node;
+    META(LazyItem, name, sub);
+
+    const std::string& fileDescriptor() const override
+    {
+        return examples::example3::descriptor();
+    }
+
+    std::string protoName() const override
+    {
+        return "test3.Item";
+    }
+};
+
+struct Envelope : public pack::Node
+{
+    pack::String id    = FIELD("id");
+    Routed       route = FIELD("route");
+
+    using pack::Node::Node;
+    META(Envelope, id, route);
+};
+
+TEST_CASE("Lazy node")
+{
+    SECTION("Json")
+    {
+        Routed msg;
+        REQUIRE(pack::json::deserialize(R"({"to":"dst","payload":{"name":"data","values":[1,2,3]}})", msg));
+        CHECK(msg.to == "dst");
+        CHECK(msg.payload.isRaw());
+        CHECK(msg.payload.format() == pack::ILazy::Format::Json);
+
+        // Not touched payload is copied back
+        msg.to = "other";
+        CHECK(*pack::json::serialize(msg) == R"({"to":"other","payload":{"name":"data","values":[1,2,3]}})");
+        CHECK(*pack::json::serializedSize(msg, pack::Option::PrettyPrint) == pack::json::serialize(msg, pack::Option::PrettyPrint)->size());
+        CHECK(msg.payload.isRaw());
+
+        // First access decodes
+        CHECK(msg.payload->name == "data");
+        CHECK(!msg.payload.isRaw());
+        CHECK(msg.payload->values.size() == 3);
+
+        msg.payload->name = "changed";
+        CHECK(*pack::json::serialize(msg) == R"({"to":"other","payload":{"name":"changed","values":[1,2,3]}})");
+    }
+
+    SECTION("Json slice")
+    {
+        // Raw content is the slice of the input without spaces, spaces in strings are kept
+        Routed msg;
+        REQUIRE(pack::json::deserialize(
+            "{\"to\": \"dst\",\n  \"payload\" : {\n    \"name\": \"my data\",\n    \"values\": [1, 2,3]\n  }\n}", msg));
+        CHECK(msg.to == "dst");
+        CHECK(msg.payload.raw() == R"({"name":"my data","values":[1,2,3]})");
+
+        CHECK(*pack::json::serialize(msg) == R"({"to":"dst","payload":{"name":"my data","values":[1,2,3]}})");
+        CHECK(*pack::json::serializedSize(msg) == pack::json::serialize(msg)->size());
+        CHECK(msg.payload.isRaw());
+
+        // Pretty and canonical forms are formatted
+        std::string pretty = *pack::json::serialize(msg, pack::Option::PrettyPrint);
+        CHECK(pretty ==
+              "{\n    \"to\": \"dst\",\n    \"payload\": {\n        \"name\": \"my data\",\n        \"values\": [\n            1,\n"
+              "            2,\n            3\n        ]\n    }\n}");
+        CHECK(*pack::json::serializedSize(msg, pack::Option::PrettyPrint) == pretty.size());
+        CHECK(*pack::json::serialize(msg, pack::Option::Canonical) == R"({"payload":{"name":"my data","values":[1,2,3]},"to":"dst"})");
+        CHECK(msg.payload.isRaw());
+
+        // Lazy in the sub node, strings looking like json
+        Envelope env;
+        REQUIRE(pack::json::deserialize(R"({"id":"{\"}[","route":{"payload":{"name":"x\"}"},"to":"a"}})", env));
+        CHECK(env.id == "{\"}[");
+        CHECK(env.route.to == "a");
+        CHECK(env.route.payload.raw() == R"({"name":"x\"}"})");
+        CHECK(env.route.payload->name == "x\"}");
+
+        REQUIRE(pack::json::deserialize(R"({"to":"dst","payload":null})", msg));
+        CHECK(!msg.payload.isRaw());
+        CHECK(!msg.payload.hasValue());
+
+        CHECK(!pack::json::deserialize(R"({"to":"dst","payload":{"name":"data")", msg));
+    }
+
+    SECTION("Json lines")
+    {
+        // Lazy content read from pretty json is written in one line
+        pack::ObjectList<Routed> list;
+        REQUIRE(pack::json::deserialize(
+            "[\n  {\n    \"to\": \"x\",\n    \"payload\": {\n      \"name\": \"n\",\n      \"values\": [1, 2]\n    }\n  }\n]", list));
+        REQUIRE(list.size() == 1);
+
+        // Formatted content set by hand too
+        list.append().to = "y";
+        list[1].payload.setRaw(pack::ILazy::Format::Json, "{\n  \"name\": \"m m\"\n}");
+        CHECK(*pack::json::serializedSize(list[1]) == pack::json::serialize(list[1])->size());
+
+        std::stringstream ss;
+        REQUIRE(pack::json::serializeLines(ss, list));
+        CHECK(ss.str() ==
+              "{\"to\":\"x\",\"payload\":{\"name\":\"n\",\"values\":[1,2]}}\n"
+              "{\"to\":\"y\",\"payload\":{\"name\":\"m m\"}}\n");
+
+        pack::ObjectList<Routed> restored;
+        int                      batches = 0;
+        REQUIRE(pack::json::deserializeLines(ss, restored, 10, [&](pack::IObjectList&) {
+            ++batches;
+            REQUIRE(restored.size() == 2);
+            CHECK(restored[0].to == "x");
+            CHECK(restored[0].payload->values.size() == 2);
+            CHECK(restored[1].payload->name == "m m");
+        }));
+        CHECK(batches == 1);
+    }
+
+    SECTION("Yaml")
+    {
+        Routed origin;
+        origin.to            = "dst";
+        origin.payload->name = "data";
+
+        // Yaml tree is built by the parser anyway, decoded immediately
+        Routed msg;
+        REQUIRE(pack::yaml::deserialize(*pack::yaml::serialize(origin), msg));
+        CHECK(!msg.payload.isRaw());
+        CHECK(*pack::yaml::serialize(msg) == *pack::yaml::serialize(origin));
+        CHECK(*pack::json::serialize(msg) == R"({"to":"dst","payload":{"name":"data"}})");
+        CHECK(msg == origin);
+    }
+
+    SECTION("Protobuf")
+    {
+        test3::Item origin;
+        origin.name       = "item";
+        origin.sub.exists = true;
+        origin.sub.name   = "sub";
+
+        LazyItem item;
+        REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(origin), item));
+        CHECK(item.name == "item");
+        CHECK(item.sub.isRaw());
+
+        test3::Item restored;
+        REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(item), restored));
+        CHECK(restored == origin);
+
+        CHECK(item.sub->name == "sub");
+        CHECK(item.sub->exists == true);
+        CHECK(!item.sub.isRaw());
+    }
+
+    SECTION("Broken content")
+    {
+        Routed msg;
+        REQUIRE(pack::json::deserialize(R"({"to":"dst","payload":{"values":{"a":"b"}}})", msg));
+        CHECK_THROWS(msg.payload.value());
+    }
+}
@@ -39,6 +39,22 @@ TEST_CASE("Map serialization/deserialization")
 
     check(origin);
 
+    SECTION("Entries")
+    {
+        const pack::IProtoMap& map = origin.intMap;
+        CHECK(static_cast<const pack::String&>(map.entryKey(1)) == "key2");
+        CHECK(static_cast<const pack::Int32&>(map.entryValue(1)).value() == 66);
+
+        test5::Item restored;
+        restored.name = "some name";
+        for (int i = 0; i < map.size(); ++i) {
+            auto [key, value] = static_cast<pack::IProtoMap&>(restored.intMap).createEntry();
+            key.set(map.entryKey(i));
+            value.set(map.entryValue(i));
+        }
+        check(restored);
+    }
+
     SECTION("Serialization yaml")
     {
         std::string cnt = *pack::yaml::serialize(origin);
@@ -53,7 +69,9 @@ TEST_CASE("Map serialization/deserialization")
     SECTION("Serialization json")
     {
         std::string cnt = *pack::json::serialize(origin);
+        CHECK(*pack::json::serializedSize(origin) == cnt.size());
         REQUIRE(!cnt.empty());
+        CHECK(cnt == R"({"name":"some name","intMap":{"key1":42,"key2":66}})");
 
         test5::Item restored;
         pack::json::deserialize(cnt, restored);
@@ -127,7 +145,9 @@ TEST_CASE("Map of structs serialization/deserialization")
     SECTION("Serialization json")
     {
         std::string cnt = *pack::json::serialize(origin);
+        CHECK(*pack::json::serializedSize(origin) == cnt.size());
         REQUIRE(!cnt.empty());
+        CHECK(cnt == R"({"name":"some name","intMap":{"key1":{"value":"value 1"},"key2":{"value":"value 2"}}})");
 
         test5::Item1 restored;
         pack::json::deserialize(cnt, restored);
@@ -210,6 +230,7 @@ TEST_CASE("Simple map serialization/deserialization")
     SECTION("Serialization json")
     {
         std::string cnt = *pack::json::serialize(origin);
+        CHECK(*pack::json::serializedSize(origin) == cnt.size());
         REQUIRE(!cnt.empty());
 
         TestMap restored;
@@ -0,0 +1,616 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+#include "examples/example1.h"
+#include "examples/example2.h"
+#include "examples/example3.h"
+#include "examples/example4.h"
+#include "examples/example5.h"
+#include "examples/example6.h"
+#include "examples/example9.h"
+#include "examples/example10.h"
+#include "examples/example11.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <fcntl.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+TEST_CASE("Protobuf wire format")
+{
+    SECTION("Scalars")
+    {
+        test::Person person;
+        person.name = "Person";
+        person.id   = 42;
+        person.binary.setString("ab");
+
+        // Empty email is not written (proto3)
+        CHECK(*pack::protobuf::serialize(person) == "\x0a\x06Person\x10\x2a\x22\x02\x61\x62"s);
+
+        test4::Item item;
+        item.enval = test4::Item::EnumValue::Value3;
+        CHECK(*pack::protobuf::serialize(item) == "\x08\x02"s);
+    }
+
+    SECTION("Repeated and negative values")
+    {
+        test::Person2 person;
+        person.value = -1;
+        person.items.append(1);
+        person.items.append(300);
+        person.more.append().name = "x";
+
+        std::string cnt = *pack::protobuf::serialize(person);
+        CHECK(cnt == "\x12\x03\x01\xac\x02\x18\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01\x22\x03\x0a\x01x"s);
+
+        test::Person2 restored;
+        REQUIRE(pack::protobuf::deserialize(cnt, restored));
+        CHECK(restored == person);
+    }
+
+    SECTION("Long nested message")
+    {
+        test3::Item item;
+        item.sub.name = std::string(200, 'a');
+
+        std::string cnt = *pack::protobuf::serialize(item);
+        REQUIRE(cnt.size() == 206);
+        CHECK(cnt.substr(0, 6) == "\x12\xcb\x01\x12\xc8\x01"s);
+        CHECK(*pack::protobuf::serializedSize(item) == cnt.size());
+
+        test3::Item restored;
+        REQUIRE(pack::protobuf::deserialize(cnt, restored));
+        CHECK(restored == item);
+    }
+
+    SECTION("Unpacked values and unknown fields")
+    {
+        test::Person2 restored;
+        REQUIRE(pack::protobuf::deserialize("\x10\x01\x78\x05\x10\x02\x0a\x01n"s, restored));
+        CHECK(restored.name == "n");
+        REQUIRE(restored.items.size() == 2);
+        CHECK(restored.items[0] == 1);
+        CHECK(restored.items[1] == 2);
+    }
+
+    SECTION("Broken content")
+    {
+        test::Person restored;
+        CHECK(!pack::protobuf::deserialize("\x0a\x10\x61\x62"s, restored));
+        CHECK(!pack::protobuf::deserialize("\x10\xff"s, restored));
+        CHECK(!pack::protobuf::deserialize("\x12\x01\x61"s, restored));
+    }
+}
+
+TEST_CASE("Protobuf generated codec")
+{
+    // Field mask switches generated codec off, so output of the descriptor driven codec is compared
+    auto check = [](const auto& node, const pack::FieldMask& all) {
+        using Type = std::decay_t<decltype(node)>;
+
+        std::string generated;
+        REQUIRE(node.encodeProto(generated));
+        CHECK(*pack::protobuf::serialize(node) == generated);
+        CHECK(*pack::protobuf::serialize(node, all) == generated);
+
+        size_t size = 0;
+        REQUIRE(node.protoSize(size));
+        CHECK(size == generated.size());
+        CHECK(*pack::protobuf::serializedSize(node) == generated.size());
+        {
+            pack::FieldMask::Scope scope(&all);
+            CHECK(*pack::protobuf::serializedSize(node) == generated.size());
+        }
+
+        Type restored;
+        REQUIRE(restored.decodeProto(generated));
+        CHECK(restored == node);
+
+        Type masked;
+        REQUIRE(pack::protobuf::deserialize(generated, masked, all));
+        CHECK(masked == node);
+    };
+
+    SECTION("Lists and nested")
+    {
+        test::Person2 person;
+        person.name  = "person";
+        person.value = -42;
+        person.items.append(1);
+        person.items.append(100000);
+        person.more.append().name = "more";
+        check(person, {"name", "value", "items", "more"});
+
+        test3::Item item;
+        item.name       = "item";
+        item.sub.exists = true;
+        item.sub.name   = std::string(300, 's');
+        check(item, {"name", "sub"});
+    }
+
+    SECTION("Maps and enums")
+    {
+        test5::Item1 item;
+        item.name = "item";
+        test5::SubItem sub;
+        sub.value = "value";
+        item.intMap.append("key", sub);
+        check(item, {"name", "intMap"});
+
+        test4::Item en;
+        en.enval = test4::Item::EnumValue::Value2;
+        check(en, {"enval"});
+    }
+
+    SECTION("Absent fields are reset")
+    {
+        test3::Item item;
+        item.name       = "item";
+        item.sub.exists = true;
+        REQUIRE(item.decodeProto("\x12\x00"s));
+        CHECK(item.name == "");
+        CHECK(item.sub.exists == false);
+    }
+
+    SECTION("Messages with imported types use descriptor")
+    {
+        test6::Item item;
+        item.name = "item";
+        std::string out;
+        CHECK(!item.encodeProto(out));
+        CHECK(pack::protobuf::serialize(item));
+    }
+}
+
+TEST_CASE("Protobuf packed values")
+{
+    test9::Waveform wave;
+    wave.name = "wave";
+    for (int i = 0; i < 10000; ++i) {
+        wave.samples.append(i * 0.5);
+        wave.gains.append(float(i) / 4);
+        wave.deltas.append(i % 2 ? -i : i);
+        wave.stamps.append(uint64_t(i) << 40);
+    }
+
+    SECTION("Layout")
+    {
+        test9::Waveform small;
+        small.samples.append(1.0);
+        small.deltas.append(-1);
+        CHECK(*pack::protobuf::serialize(small) == "\x12\x08\x00\x00\x00\x00\x00\x00\xf0\x3f\x22\x01\x01"s);
+    }
+
+    SECTION("Generated codec")
+    {
+        std::string cnt = *pack::protobuf::serialize(wave);
+        CHECK(*pack::protobuf::serializedSize(wave) == cnt.size());
+
+        test9::Waveform restored;
+        REQUIRE(pack::protobuf::deserialize(cnt, restored));
+        CHECK(restored == wave);
+    }
+
+    SECTION("Descriptor codec")
+    {
+        pack::FieldMask all{"name", "samples", "gains", "deltas", "stamps"};
+        std::string     cnt = *pack::protobuf::serialize(wave, all);
+        CHECK(cnt == *pack::protobuf::serialize(wave));
+
+        test9::Waveform restored;
+        REQUIRE(pack::protobuf::deserialize(cnt, restored, all));
+        CHECK(restored == wave);
+    }
+
+    SECTION("Chunks")
+    {
+        // Packed field could come in many chunks, values are appended
+        test9::Waveform restored;
+        REQUIRE(pack::protobuf::deserialize(
+            "\x12\x08\x00\x00\x00\x00\x00\x00\xf0\x3f\x12\x10\x00\x00\x00\x00\x00\x00\x00\x40\x00\x00\x00\x00\x00\x00\x08\x40"s,
+            restored));
+        CHECK(restored.samples.value() == std::vector<double>{1.0, 2.0, 3.0});
+    }
+
+    SECTION("Broken packed content")
+    {
+        test9::Waveform restored;
+        CHECK(!pack::protobuf::deserialize("\x12\x03\x00\x00\x00"s, restored));
+    }
+}
+
+TEST_CASE("Protobuf context")
+{
+    pack::protobuf::Context ctx;
+
+    test::Person person;
+    person.name = "person";
+    person.id   = 1;
+
+    test3::Item item;
+    item.name     = "item";
+    item.sub.name = "sub";
+
+    for (int i = 0; i < 3; ++i) {
+        person.id = i;
+
+        auto cnt = ctx.serialize(person);
+        REQUIRE(cnt);
+        CHECK(std::string(*cnt) == *pack::protobuf::serialize(person));
+
+        test::Person restored;
+        REQUIRE(ctx.deserialize(*cnt, restored));
+        CHECK(restored == person);
+
+        auto other = ctx.serialize(item);
+        REQUIRE(other);
+
+        test3::Item restoredItem;
+        REQUIRE(ctx.deserialize(*other, restoredItem));
+        CHECK(restoredItem == item);
+    }
+
+    pack::String str;
+    CHECK(!ctx.serialize(str));
+    CHECK(!ctx.deserialize("\x0a", str));
+}
+
+TEST_CASE("Protobuf zero copy input and output")
+{
+    test::Person person;
+    person.name  = "person";
+    person.email = "person@email.org";
+    person.id    = 42;
+
+    std::string expected = *pack::protobuf::serialize(person);
+
+    SECTION("Views")
+    {
+        std::string      buffer = "header" + expected;
+        std::string_view view   = std::string_view(buffer).substr(6);
+
+        test::Person restored;
+        REQUIRE(pack::protobuf::deserialize(view, restored));
+        CHECK(restored == person);
+    }
+
+    SECTION("Zero copy stream")
+    {
+        std::string out;
+        {
+            google::protobuf::io::StringOutputStream stream(&out);
+            REQUIRE(pack::protobuf::serialize(person, stream));
+        }
+        CHECK(out == expected);
+    }
+
+    SECTION("File descriptor and file")
+    {
+        char fileName[] = "/tmp/fty-pack-protobuf-XXXXXX";
+        int  fd         = mkstemp(fileName);
+        REQUIRE(fd >= 0);
+        REQUIRE(pack::protobuf::serializeToFd(person, fd));
+        close(fd);
+
+        test::Person restored;
+        REQUIRE(pack::protobuf::deserializeFile(fileName, restored));
+        CHECK(restored == person);
+
+        person.id = 43;
+        REQUIRE(pack::protobuf::serializeFile(fileName, person));
+        REQUIRE(pack::protobuf::deserializeFile(fileName, restored));
+        CHECK(restored.id == 43);
+
+        // Empty file is an empty message
+        REQUIRE(pack::protobuf::serializeFile(fileName, test::Person{}));
+        REQUIRE(pack::protobuf::deserializeFile(fileName, restored));
+        CHECK(restored == test::Person{});
+
+        unlink(fileName);
+        CHECK(!pack::protobuf::deserializeFile(fileName, restored));
+        CHECK(!pack::protobuf::serializeToFd(person, -1));
+    }
+}
+
+TEST_CASE("Protobuf delimited stream")
+{
+    pack::ObjectList<test::Person> list;
+    for (int i = 0; i < 3; ++i) {
+        auto& it = list.append();
+        it.name  = "person " + std::to_string(i);
+        it.id    = i;
+        if (i == 1) {
+            it.email = "person@email.org";
+        }
+    }
+
+    std::stringstream st;
+    REQUIRE(pack::protobuf::serializeDelimited(st, list));
+
+    std::string cnt = st.str();
+    // Length, then the message
+    CHECK(cnt.substr(0, 11) == "\x0a\x0a\x08person 0"s);
+
+    SECTION("Stream")
+    {
+        int count = 0;
+        REQUIRE(pack::protobuf::deserializeDelimited<test::Person>(st, [&](const test::Person& item) {
+            CHECK(item == list[count]);
+            ++count;
+        }));
+        CHECK(count == 3);
+    }
+
+    SECTION("Buffer")
+    {
+        test::Person item;
+        int          count = 0;
+        REQUIRE(pack::protobuf::deserializeDelimited(cnt, item, [&]() {
+            // Email of the previous message is not kept
+            CHECK(item == list[count]);
+            ++count;
+        }));
+        CHECK(count == 3);
+    }
+
+    SECTION("Broken")
+    {
+        test::Person       item;
+        std::istringstream truncated(cnt.substr(0, cnt.size() - 1));
+        int                count = 0;
+        auto               ret   = pack::protobuf::deserializeDelimited(truncated, item, [&]() {
+            ++count;
+        });
+        CHECK(!ret);
+        CHECK(count == 2);
+        CHECK(!pack::protobuf::deserializeDelimited(std::string_view(cnt).substr(0, 5), item, [] {}));
+    }
+}
+
+namespace {
+
+struct Circle : public pack::Node
+{
+    pack::Double radius = FIELD("radius");
+
+    using pack::Node::Node;
+    META(Circle, radius);
+};
+
+struct Square : public pack::Node
+{
+    pack::Double side = FIELD("side");
+
+    using pack::Node::Node;
+    META(Square, side);
+};
+
+/// Same layout as test10::Shape, but with pack maps and variant
+struct Shape : public pack::Node
+{
+    pack::String                  name    = FIELD("name");
+    pack::Variant<Circle, Square> kind    = FIELD("kind");
+    pack::Int32Map                counts  = FIELD("counts");
+    pack::Map<Circle>             circles = FIELD("circles");
+
+    using pack::Node::Node;
+    META(Shape, name, kind, counts, circles);
+
+    const std::string& fileDescriptor() const override
+    {
+        return examples::example10::descriptor();
+    }
+
+    std::string protoName() const override
+    {
+        return "test10.Shape";
+    }
+};
+
+/// Same layout as test11::Settings, the declared defaults are in the proto2 file only
+struct Settings : public pack::Node
+{
+    enum class Mode
+    {
+        Off,
+        Auto
+    };
+
+    pack::String     name    = FIELD("name");
+    pack::Int32      count   = FIELD("count");
+    pack::Double     ratio   = FIELD("ratio");
+    pack::Enum<Mode> mode    = FIELD("mode");
+    pack::Int64      offset  = FIELD("offset");
+    pack::Bool       enabled = FIELD("enabled");
+    pack::Int32      plain   = FIELD("plain");
+
+    using pack::Node::Node;
+    META(Settings, name, count, ratio, mode, offset, enabled, plain);
+
+    const std::string& fileDescriptor() const override
+    {
+        return examples::example11::descriptor();
+    }
+
+    std::string protoName() const override
+    {
+        return "test11.Settings";
+    }
+};
+
+} // namespace
+
+TEST_CASE("Protobuf maps and variants")
+{
+    Shape shape;
+    shape.name = "shape";
+    shape.kind.reset<Square>().side = 2;
+    shape.counts.append("a", 1);
+    shape.counts.append("b", 2);
+    shape.circles.append("c").radius = 3;
+
+    test10::Shape generated;
+    generated.name        = "shape";
+    generated.square.side = 2;
+    generated.counts.append("a", 1);
+    generated.counts.append("b", 2);
+    test10::Circle circle;
+    circle.radius = 3;
+    generated.circles.append("c", circle);
+
+    std::string cnt = *pack::protobuf::serialize(shape);
+    CHECK(cnt == *pack::protobuf::serialize(generated));
+    CHECK(*pack::protobuf::serializedSize(shape) == cnt.size());
+    CHECK(*pack::protobuf::serializedSize(generated) == cnt.size());
+
+    Shape restored;
+    REQUIRE(pack::protobuf::deserialize(cnt, restored));
+    REQUIRE(restored.kind.is<Square>());
+    CHECK(restored.kind.get<Square>().side == 2);
+    CHECK(restored.counts.value() == shape.counts.value());
+    REQUIRE(restored.circles.size() == 1);
+    CHECK(restored.circles["c"].radius == 3);
+    CHECK(restored == shape);
+
+    // Other alternative
+    shape.kind.reset<Circle>().radius = 1;
+    REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(shape), restored));
+    REQUIRE(restored.kind.is<Circle>());
+    CHECK(restored.kind.get<Circle>().radius == 1);
+
+    REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(shape), generated));
+    CHECK(generated.circle.radius == 1);
+    CHECK(!generated.square.hasValue());
+}
+
+TEST_CASE("Protobuf reused node")
+{
+    pack::protobuf::Context ctx;
+
+    SECTION("Generated codec")
+    {
+        test::Person first;
+        first.name = "first";
+        first.binary.setString("bin");
+
+        test::Person second;
+        second.name = "second";
+
+        test::Person person;
+        REQUIRE(ctx.deserialize(*ctx.serialize(first), person));
+        CHECK(person == first);
+        REQUIRE(ctx.deserialize(*ctx.serialize(second), person));
+        CHECK(person.binary.asString() == "");
+        CHECK(person == second);
+
+        test::Person2 many;
+        many.items.append(1);
+        many.items.append(2);
+        many.more.append().name = "more";
+
+        test::Person2 other;
+        other.items.append(3);
+
+        test::Person2 restored;
+        REQUIRE(ctx.deserialize(*ctx.serialize(many), restored));
+        REQUIRE(ctx.deserialize(*ctx.serialize(other), restored));
+        CHECK(restored.items.value() == std::vector<int32_t>{3});
+        CHECK(restored.more.empty());
+    }
+
+    SECTION("Descriptor")
+    {
+        Shape first;
+        first.kind.reset<Square>().side = 1;
+        first.counts.append("a", 1);
+        first.circles.append("c").radius = 2;
+
+        Shape second;
+        second.name = "second";
+        second.counts.append("b", 2);
+
+        Shape shape;
+        REQUIRE(ctx.deserialize(*ctx.serialize(first), shape));
+        CHECK(shape == first);
+        REQUIRE(ctx.deserialize(*ctx.serialize(second), shape));
+        // Variant is never empty, cleared one holds the first alternative
+        REQUIRE(shape.kind.is<Circle>());
+        CHECK(shape.kind.get<Circle>().radius == 0);
+        CHECK(shape.counts.size() == 1);
+        CHECK(shape.circles.size() == 0);
+        CHECK(shape == second);
+
+        // Masked fields only
+        REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(first), shape, {"counts"}));
+        CHECK(shape.counts.value() == first.counts.value());
+        CHECK(shape.name == "second");
+    }
+}
+
+TEST_CASE("Protobuf preload")
+{
+    CHECK(pack::protobuf::preload<test::Person, test3::Item, test9::Waveform>(2));
+    CHECK(pack::protobuf::preloadAll());
+
+    // Every generated file is registered
+    auto files = pack::registeredFileDescriptors();
+    CHECK(std::find(files.begin(), files.end(), &examples::example1::descriptor) != files.end());
+    CHECK(std::find(files.begin(), files.end(), &examples::example10::descriptor) != files.end());
+
+    Shape shape;
+    shape.name = "shape";
+    CHECK(pack::protobuf::preload({&shape}));
+
+    std::string cnt = *pack::protobuf::serialize(shape);
+    Shape       restored;
+    REQUIRE(pack::protobuf::deserialize(cnt, restored));
+    CHECK(restored == shape);
+}
+
+TEST_CASE("Protobuf proto2 defaults")
+{
+    Settings settings;
+    settings.name    = "other";
+    settings.count   = 1;
+    settings.ratio   = 2;
+    settings.mode    = Settings::Mode::Off;
+    settings.offset  = 4;
+    settings.enabled = false;
+    settings.plain   = 6;
+
+    // Only `plain` is present, the absent fields get the declared defaults
+    REQUIRE(pack::protobuf::deserialize(std::string("\x38\x07", 2), settings));
+    CHECK(settings.name == "unit");
+    CHECK(settings.count == 5);
+    CHECK(settings.ratio == 0.5);
+    CHECK(settings.mode == Settings::Mode::Auto);
+    CHECK(settings.offset == -3);
+    CHECK(settings.enabled == true);
+    CHECK(settings.plain == 7);
+
+    // Field without declared default is reset to the empty value
+    REQUIRE(pack::protobuf::deserialize(std::string(), settings));
+    CHECK(settings.plain == 0);
+    CHECK(settings.name == "unit");
+
+    Settings restored;
+    REQUIRE(pack::protobuf::deserialize(*pack::protobuf::serialize(settings), restored));
+    CHECK(restored == settings);
+}
@@ -0,0 +1,101 @@
+/*  ========================================================================================================================================
+    Copyright (C) 2020 Eaton
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================================================================================
+*/
+#include <catch2/catch.hpp>
+#include <pack/pack.h>
+#include "providers/json.h"
+
+struct Sample : public pack::Node
+{
+    struct Metric : public pack::Node
+    {
+        pack::String name  = FIELD("name");
+        pack::Double value = FIELD("value");
+        pack::Int64  time  = FIELD("time");
+
+        using pack::Node::Node;
+        META(Metric, name, value, time);
+    };
+
+    pack::String             id      = FIELD("id");
+    pack::UInt32             status  = FIELD("status");
+    pack::Bool               active  = FIELD("active");
+    pack::StringList         tags    = FIELD("tags");
+    pack::ObjectList<Metric> metrics = FIELD("metrics");
+    pack::Map<Metric>        last    = FIELD("last");
+    pack::Int32Map           counts  = FIELD("counts");
+
+    using pack::Node::Node;
+    META(Sample, id, status, active, tags, metrics, last, counts);
+};
+
+TEST_CASE("Simdjson deserialization")
+{
+    SECTION("Values as string")
+    {
+        Sample sample;
+        REQUIRE(pack::json::deserialize(R"({"id":"a","status":"42","active":"true","counts":{"one":1}})", sample));
+        CHECK(sample.id == "a");
+        CHECK(sample.status == 42);
+        CHECK(sample.active == true);
+        CHECK(sample.counts["one"] == 1);
+    }
+
+    SECTION("Nulls and unknown keys")
+    {
+        Sample sample;
+        REQUIRE(pack::json::deserialize(R"({"id":null,"unknown":[1,2],"tags":["a",null]})", sample));
+        CHECK(sample.id == "");
+        CHECK(sample.tags.value() == std::vector<std::string>{"a", ""});
+    }
+
+    SECTION("Broken content")
+    {
+        Sample sample;
+        CHECK(!pack::json::deserialize(R"({"id":"a")", sample));
+        CHECK(!pack::json::deserialize(R"({"id":{}})", sample));
+    }
+}
+
+TEST_CASE("Simdjson deserialization benchmark", "[!benchmark]")
+{
+    Sample sample;
+    sample.id     = "sample";
+    sample.status = 3;
+    sample.active = true;
+    sample.tags.setValue({"one", "two", "three"});
+    for (int i = 0; i < 100; ++i) {
+        auto& metric = sample.metrics.append();
+        metric.name  = "metric." + std::to_string(i);
+        metric.value = i * 1.5;
+        metric.time  = 1600000000 + i;
+        sample.last.append(metric.name, metric);
+        sample.counts.append(metric.name, i);
+    }
+    std::string content = *pack::json::serialize(sample);
+
+    // The same work as deserialize did before: nlohmann parse and pack visitor
+    BENCHMARK("pack::json::deserialize (nlohmann)")
+    {
+        Sample restored;
+        return pack::json::decodeNlohmann(content, restored);
+    };
+
+    BENCHMARK("pack::json::deserialize (simdjson)")
+    {
+        Sample restored;
+        return pack::json::deserialize(content, restored);
+    };
+}
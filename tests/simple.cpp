@@ -15,6 +15,8 @@
 */
 #include <catch2/catch.hpp>
 #include "examples/example1.h"
+#include <atomic>
+#include <thread>
 
 TEST_CASE("Simple serialization/deserialization")
 {
@@ -71,12 +73,54 @@ TEST_CASE("Simple serialization/deserialization")
     {
         std::string cnt = *pack::protobuf::serialize(origin);
         REQUIRE(!cnt.empty());
+        CHECK(*pack::protobuf::serializedSize(origin) == cnt.size());
 
         test::Person restored;
         pack::protobuf::deserialize(cnt, restored);
 
         check(restored);
     }
+
+    SECTION("Serialization protobuf from many threads")
+    {
+        std::vector<std::thread> threads;
+        std::atomic<int>         failed{0};
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&]() {
+                for (int j = 0; j < 100; ++j) {
+                    test::Person restored;
+                    if (!pack::protobuf::deserialize(*pack::protobuf::serialize(origin), restored) || restored != origin) {
+                        ++failed;
+                    }
+                }
+            });
+        }
+        for (auto& it : threads) {
+            it.join();
+        }
+        CHECK(failed == 0);
+    }
+
+    SECTION("Serialization protobuf batch")
+    {
+        test::Person other = origin;
+        other.id           = 43;
+
+        pack::Batch batch;
+        REQUIRE(pack::protobuf::serialize({&origin, &other}, batch));
+        REQUIRE(batch.size() == 2);
+        CHECK(batch[0] == *pack::protobuf::serialize(origin));
+        CHECK(batch[1] == *pack::protobuf::serialize(other));
+
+        test::Person restored;
+        pack::protobuf::deserialize(std::string(batch[0]), restored);
+        check(restored);
+
+        std::vector<test::Person> many(2);
+        REQUIRE(pack::protobuf::deserializeMany({batch[0], batch[1]}, {&many[0], &many[1]}, 2));
+        check(many[0]);
+        CHECK(many[1].id == 43);
+    }
 }
 
 TEST_CASE("UTF-8 test")